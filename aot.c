@@ -0,0 +1,112 @@
+#include "headers/chip8.h"
+#include "headers/aot.h"
+
+#include <dlfcn.h>
+#include <limits.h>
+#include <string.h>
+
+/*
+    - runs a ROM through the module ./recompile built for it, falling back to emulateCycle for anything the module
+      does not cover: addresses the static analysis never reached, instructions it leaves out (Fx33, Fx55, 0nnn, unknown
+      opcodes), and code that no longer matches the ROM because something wrote over it
+    - enabled[] starts as the module's compiled[] minus every instruction whose bytes differ from memory, and loses
+      entries as Fx33/Fx55 write into code. The module checks it at every instruction, so a write can never be missed
+*/
+
+static const AotRuntime runtime = { clearScreen, drawSprite, nextRandom };
+
+AotCache* createAotCache() {
+    AotCache* aot = malloc(sizeof(AotCache));
+    if (aot == NULL) {
+        fprintf(stderr, "Error allocating the AOT cache\n");
+        return NULL;
+    }
+    aot->handle = NULL;
+    aot->module = NULL;
+    resetAotCache(aot);
+    return aot;
+}
+
+void destroyAotCache(AotCache* aot) {
+    if (aot == NULL)
+        return;
+    if (aot->handle != NULL)
+        dlclose(aot->handle);
+    free(aot);
+}
+
+int loadAotModule(AotCache* aot, const char* romPath) {
+    // the module for a ROM is <ROM PATH>.so (make <ROM PATH>.so builds it)
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%s.so", strchr(romPath, '/') ? "" : "./", romPath);
+
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        fprintf(stderr, "Error loading %s: %s\n", path, dlerror());
+        return 1;
+    }
+    const AotModule* module = dlsym(handle, AOT_MODULE_SYMBOL);
+    if (module == NULL || module->abiVersion != AOT_ABI_VERSION || module->stateSize != (int)sizeof(CHIP8)) {
+        fprintf(stderr, "%s was built for a different version of the emulator, rebuild it\n", path);
+        dlclose(handle);
+        return 1;
+    }
+
+    if (aot->handle != NULL)
+        dlclose(aot->handle);
+    aot->handle = handle;
+    aot->module = module;
+    resetAotCache(aot);
+    return 0;
+}
+
+void resetAotCache(AotCache* aot) {
+    // memory may have changed from outside (a ROM loaded, a state restored): check it again before the next run
+    memset(aot->enabled, 0, sizeof(aot->enabled));
+    aot->synced = 0;
+}
+
+static void syncAotCache(AotCache* aot, const unsigned char* memory) {
+    const AotModule* module = aot->module;
+    for (int address = ROM_START; address + 1 < ROM_START + module->romSize; address++)
+        aot->enabled[address] = module->compiled[address]
+            && memory[address] == module->rom[address - ROM_START]
+            && memory[address + 1] == module->rom[address + 1 - ROM_START];
+    aot->synced = 1;
+}
+
+void invalidateAotCache(AotCache* aot, unsigned short address, unsigned short length) {
+    // the instruction at address - 1 reads the first written byte as its second half
+    for (int i = -1; i < length; i++)
+        aot->enabled[(address + i) & (MEMORY_SIZE - 1)] = 0;
+}
+
+void runAot(CHIP8* chip8, AotCache* aot, unsigned long cycles) {
+    if (aot->module != NULL && !aot->synced)
+        syncAotCache(aot, chip8->memory);
+
+    while (cycles > 0) {
+        unsigned short pc = chip8->pc;
+
+        if (pc < MEMORY_SIZE && aot->enabled[pc]) {
+            int budget = cycles > INT_MAX ? INT_MAX : (int)cycles;
+            cycles -= budget - aot->module->run(chip8, &runtime, aot->enabled, budget);
+            continue;
+        }
+
+        // everything else goes through the interpreter; Fx33 and Fx55 may have written over compiled code
+        unsigned short opcode = (chip8->memory[pc] << 8) | chip8->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+        unsigned short written = 0;
+        if ((opcode & 0xF0FF) == 0xF033)
+            written = 3;
+        else if ((opcode & 0xF0FF) == 0xF055)
+            written = ((opcode & 0x0F00) >> 8) + 1;
+
+        unsigned short address = chip8->I;
+        emulateCycle(chip8);
+        cycles--;
+
+        if (written)
+            invalidateAotCache(aot, address, written);
+    }
+}
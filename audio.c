@@ -0,0 +1,152 @@
+#include "headers/chip8.h"
+#include "headers/scheduler.h"
+#include "headers/audio.h"
+
+#include <string.h>
+
+static void fillAudio(void* data, Uint8* stream, int length);
+
+void openBeeper(Beeper* beeper, int bufferSamples) {
+    // without an audio device the beeper just stays off (with a warning), the emulator works fine without it
+    beeper->device = 0;
+    beeper->frame = 0;
+    beeper->on = 0;
+    beeper->dropped = 0;
+    atomic_init(&beeper->head, 0);
+    atomic_init(&beeper->tail, 0);
+    beeper->playing = 0;
+    beeper->phase = 0;
+    beeper->sampleClock = 0;
+    beeper->lastEdge = 0;
+    beeper->lastFrame = 0;
+    beeper->lastCallback = 0;
+    beeper->callbacks = 0;
+    beeper->underruns = 0;
+    beeper->latencyTotal = 0;
+    beeper->latencyMax = 0;
+    beeper->latencyCount = 0;
+
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        fprintf(stderr, "No audio, SDL_Error: %s\n", SDL_GetError());
+        return;
+    }
+
+    SDL_AudioSpec wanted, obtained;
+    memset(&wanted, 0, sizeof(wanted));
+    wanted.freq = AUDIO_FREQUENCY;
+    wanted.format = AUDIO_S16SYS;
+    wanted.channels = 1;
+    wanted.samples = bufferSamples;
+    wanted.callback = fillAudio;
+    wanted.userdata = beeper;
+
+    beeper->device = SDL_OpenAudioDevice(NULL, 0, &wanted, &obtained, 0);
+    if (beeper->device == 0) {
+        fprintf(stderr, "No audio, SDL_Error: %s\n", SDL_GetError());
+        return;
+    }
+    beeper->frequency = obtained.freq;
+    beeper->bufferSamples = obtained.samples;
+    beeper->bufferNanoseconds = obtained.samples * NANOSECONDS_PER_SECOND / obtained.freq;
+
+    SDL_PauseAudioDevice(beeper->device, 0);
+}
+
+void closeBeeper(Beeper* beeper) {
+    if (beeper->device != 0)
+        SDL_CloseAudioDevice(beeper->device);
+}
+
+void updateBeeper(Beeper* beeper, int on) {
+    // called by the emulation thread once per frame with whether the sound timer is running
+    beeper->frame++;
+    if (on == beeper->on || beeper->device == 0)
+        return;
+    beeper->on = on;
+
+    unsigned int head = atomic_load_explicit(&beeper->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&beeper->tail, memory_order_acquire) == TONE_QUEUE_SIZE) {
+        beeper->dropped++;
+        return;
+    }
+    ToneEdge* edge = &beeper->edges[head & (TONE_QUEUE_SIZE - 1)];
+    edge->frame = beeper->frame;
+    edge->time = monotonicNanoseconds();
+    edge->on = on;
+    atomic_store_explicit(&beeper->head, head + 1, memory_order_release);
+}
+
+static unsigned long long edgePosition(const Beeper* beeper, const ToneEdge* edge) {
+    // the same distance from the last edge on the sample clock as in emulated frames, unless that is already past
+    // or too far ahead (a long silence, turbo mode): then right away
+    unsigned long long samplesPerFrame = beeper->frequency / TIMER_HZ;
+    unsigned long long position = beeper->lastEdge + (edge->frame - beeper->lastFrame) * samplesPerFrame;
+    if (position < beeper->sampleClock || position > beeper->sampleClock + MAX_TONE_DELAY_FRAMES * samplesPerFrame)
+        position = beeper->sampleClock;
+    return position;
+}
+
+static void fillAudio(void* data, Uint8* stream, int length) {
+    // runs on SDL's audio thread: no locks, no allocation, nothing that can block
+    Beeper* beeper = data;
+    short* samples = (short*)stream;
+    int count = length / sizeof(short);
+
+    unsigned long long now = monotonicNanoseconds();
+    if (beeper->lastCallback != 0 && now - beeper->lastCallback > beeper->bufferNanoseconds * 3 / 2)
+        beeper->underruns++;
+    beeper->lastCallback = now;
+    beeper->callbacks++;
+
+    unsigned long long start = beeper->sampleClock;
+    int i = 0;
+    while (i < count) {
+        // play the current tone up to the next edge that falls inside this buffer (or to the end of it)
+        int end = count;
+        const ToneEdge* edge = NULL;
+        unsigned int tail = atomic_load_explicit(&beeper->tail, memory_order_relaxed);
+        if (tail != atomic_load_explicit(&beeper->head, memory_order_acquire)) {
+            edge = &beeper->edges[tail & (TONE_QUEUE_SIZE - 1)];
+            beeper->sampleClock = start + i;
+            unsigned long long position = edgePosition(beeper, edge);
+            if (position - start < (unsigned long long)count)
+                end = position - start;
+            else
+                edge = NULL;
+        }
+
+        for (; i < end; i++) {
+            samples[i] = 0;
+            if (beeper->playing)
+                samples[i] = beeper->phase < (unsigned int)beeper->frequency / 2 ? TONE_VOLUME : -TONE_VOLUME;
+            beeper->phase += TONE_HZ;
+            if (beeper->phase >= (unsigned int)beeper->frequency)
+                beeper->phase -= beeper->frequency;
+        }
+
+        if (edge != NULL) {
+            // queued -> played now, plus the time to reach this sample and the buffer the device plays first
+            unsigned long long latency = now - edge->time + i * NANOSECONDS_PER_SECOND / beeper->frequency + beeper->bufferNanoseconds;
+            beeper->latencyTotal += latency;
+            beeper->latencyCount++;
+            if (latency > beeper->latencyMax)
+                beeper->latencyMax = latency;
+
+            beeper->playing = edge->on;
+            beeper->lastEdge = start + i;
+            beeper->lastFrame = edge->frame;
+            atomic_store_explicit(&beeper->tail, tail + 1, memory_order_release);
+        }
+    }
+    beeper->sampleClock = start + count;
+}
+
+void printBeeperStats(const Beeper* beeper) {
+    if (beeper->device == 0)
+        return;
+    printf("audio: %d Hz, %d sample buffer (%.1f ms), %llu callbacks, %llu underruns, %llu edges dropped\n",
+        beeper->frequency, beeper->bufferSamples, beeper->bufferNanoseconds / 1e6, beeper->callbacks, beeper->underruns, beeper->dropped);
+    if (beeper->latencyCount > 0)
+        printf("audio latency: %.1f ms average, %.1f ms worst over %llu edges\n",
+            beeper->latencyTotal / 1e6 / beeper->latencyCount, beeper->latencyMax / 1e6, beeper->latencyCount);
+}
@@ -0,0 +1,338 @@
+#include "headers/chip8.h"
+#include "headers/batch.h"
+
+#include <string.h>
+
+/*
+    - runs a group of instances in lockstep: every step, each lane executes exactly one instruction
+    - lanes whose pc matches the step's leader execute that instruction together, one vector operation per register
+      touched, with the other lanes masked out. Instructions that need a lane's stack, screen, keys, RNG or memory
+      (00EE, 2nnn, Cxkk, Dxyn, Ex9E/ExA1, Fx65) loop over those lanes without leaving the vector path
+    - lanes that went somewhere else, code some lane has written to, and the rare instructions left over
+      (00E0, 0nnn, Fx0A, Fx33, Fx55) are run one lane at a time with emulateCycle
+    - the timers tick for every lane at the end of each frame, so the result is the same as runCycles on each instance
+    - the step loop is built twice, for AVX2 and for the baseline target, and the AVX2 copy is picked at runtime
+*/
+
+#if defined(__x86_64__)
+#define BATCH_X86
+#include <immintrin.h>
+#endif
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+// new where mask is set, old elsewhere
+#define BLEND(old, new, mask) (((new) & (mask)) | ((old) & ~(mask)))
+
+void loadLaneGroup(LaneGroup* group, CHIP8* instances, int numLanes) {
+    // numLanes is at most BATCH_LANES; the lanes past it stay inactive
+    memset(group, 0, sizeof(LaneGroup));
+    group->numLanes = numLanes;
+
+    for (int lane = 0; lane < numLanes; lane++) {
+        CHIP8* chip8 = &instances[lane];
+        group->instances[lane] = chip8;
+        for (int r = 0; r < NUM_REGISTERS; r++)
+            group->V[r][lane] = chip8->V[r];
+        group->I[lane] = chip8->I;
+        group->pc[lane] = chip8->pc;
+        group->sp[lane] = chip8->sp;
+        group->delayTimer[lane] = chip8->delayTimer;
+        group->soundTimer[lane] = chip8->soundTimer;
+        group->active[lane] = -1;
+
+        // instructions are fetched once for all lanes from lane 0, which is only right where every lane holds the same bytes
+        for (int address = 0; address < MEMORY_SIZE; address++)
+            if (chip8->memory[address] != instances[0].memory[address])
+                group->divergentCode[address] = 1;
+    }
+}
+
+void storeLaneGroup(LaneGroup* group) {
+    // write the registers back into each lane's CHIP8
+    for (int lane = 0; lane < group->numLanes; lane++) {
+        CHIP8* chip8 = group->instances[lane];
+        for (int r = 0; r < NUM_REGISTERS; r++)
+            chip8->V[r] = group->V[r][lane];
+        chip8->I = group->I[lane];
+        chip8->pc = group->pc[lane];
+        chip8->sp = group->sp[lane];
+        chip8->delayTimer = group->delayTimer[lane];
+        chip8->soundTimer = group->soundTimer[lane];
+    }
+}
+
+static void stepLane(LaneGroup* group, int lane) {
+    // run one instruction of one lane with emulateCycle
+    CHIP8* chip8 = group->instances[lane];
+    for (int r = 0; r < NUM_REGISTERS; r++)
+        chip8->V[r] = group->V[r][lane];
+    chip8->I = group->I[lane];
+    chip8->pc = group->pc[lane];
+    chip8->sp = group->sp[lane];
+    chip8->delayTimer = group->delayTimer[lane];
+    chip8->soundTimer = group->soundTimer[lane];
+
+    unsigned short opcode = (chip8->memory[chip8->pc] << 8) | chip8->memory[chip8->pc+1];
+    unsigned short I = chip8->I;
+    emulateCycle(chip8);
+
+    // a lane that wrote into memory may now disagree with the others there
+    if ((opcode & 0xF0FF) == 0xF033)
+        memset(&group->divergentCode[I & (MEMORY_SIZE - 1)], 1, I < MEMORY_SIZE - 3 ? 3 : MEMORY_SIZE - I);
+    if ((opcode & 0xF0FF) == 0xF055) {
+        int length = ((opcode & 0x0F00) >> 8) + 1;
+        for (int i = 0; i < length; i++)
+            group->divergentCode[(I + i) & (MEMORY_SIZE - 1)] = 1;
+    }
+
+    for (int r = 0; r < NUM_REGISTERS; r++)
+        group->V[r][lane] = chip8->V[r];
+    group->I[lane] = chip8->I;
+    group->pc[lane] = chip8->pc;
+    group->sp[lane] = chip8->sp;
+    group->delayTimer[lane] = chip8->delayTimer;
+    group->soundTimer[lane] = chip8->soundTimer;
+    group->scalarInstructions++;
+}
+
+ALWAYS_INLINE unsigned int laneBits(const LaneMask* mask) {
+    // bit n is set when lane n's mask is set
+#ifdef BATCH_X86
+    __m128i halves[2];
+    memcpy(halves, mask, sizeof(halves));
+    return _mm_movemask_epi8(_mm_packs_epi16(halves[0], halves[1]));
+#else
+    unsigned int bits = 0;
+    for (int lane = 0; lane < BATCH_LANES; lane++)
+        bits |= (unsigned int)((*mask)[lane] & 1) << lane;
+    return bits;
+#endif
+}
+
+ALWAYS_INLINE int stepVector(LaneGroup* group, unsigned short opcode, const LaneMask* mask, unsigned int lanes) {
+    // run opcode on every lane in mask (lanes has the same lanes as bits). Returns 0 (having done nothing) if the
+    // instruction is left to emulateCycle. Instructions that touch a lane's stack, screen, keys, RNG or memory loop over
+    // the lanes, but still skip copying every register in and out like emulateCycle would need
+    LaneWords* V = group->V;
+    CHIP8** instances = group->instances;
+    LaneWords m = (LaneWords)*mask;
+    LaneWords zero = { 0 };
+    unsigned short x = (opcode & 0x0F00) >> 8;
+    unsigned short y = (opcode & 0x00F0) >> 4;
+    unsigned short kk = opcode & 0x00FF;
+    unsigned short nnn = opcode & 0x0FFF;
+    LaneWords skip; // lanes that skip the next instruction
+
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            if (opcode != 0x00EE)
+                return 0;
+            group->sp = BLEND(group->sp, (group->sp - 1) & 0xFF, m);
+            for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                group->pc[lane] = instances[lane]->stack[group->sp[lane]] + 2;
+            }
+            return 1;
+        case 0x1000:
+            group->pc = BLEND(group->pc, zero + nnn, m);
+            return 1;
+        case 0x2000:
+            for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                instances[lane]->stack[group->sp[lane]] = group->pc[lane];
+            }
+            group->sp = BLEND(group->sp, (group->sp + 1) & 0xFF, m);
+            group->pc = BLEND(group->pc, zero + nnn, m);
+            return 1;
+        case 0x3000:
+            skip = (LaneWords)(V[x] == kk);
+            goto skipNext;
+        case 0x4000:
+            skip = (LaneWords)(V[x] != kk);
+            goto skipNext;
+        case 0x5000:
+            skip = (LaneWords)(V[x] == V[y]);
+            goto skipNext;
+        case 0x9000:
+            skip = (LaneWords)(V[x] != V[y]);
+            goto skipNext;
+        case 0x6000:
+            V[x] = BLEND(V[x], zero + kk, m);
+            break;
+        case 0x7000:
+            V[x] = BLEND(V[x], (V[x] + kk) & 0xFF, m);
+            break;
+        case 0x8000:
+            // one statement per assignment in emulateCycle, in the same order, so x or y being F works out the same
+            switch(opcode & 0x000F) {
+                case 0x0: V[x] = BLEND(V[x], V[y], m); break;
+                case 0x1: V[x] = BLEND(V[x], V[x] | V[y], m); break;
+                case 0x2: V[x] = BLEND(V[x], V[x] & V[y], m); break;
+                case 0x3: V[x] = BLEND(V[x], V[x] ^ V[y], m); break;
+                case 0x4:
+                    V[0xF] = BLEND(V[0xF], zero, m);
+                    V[x] = BLEND(V[x], (V[x] + V[y]) & 0xFF, m);
+                    break;
+                case 0x5:
+                    V[0xF] = BLEND(V[0xF], zero, m);
+                    V[0xF] = BLEND(V[0xF], zero + 1, m & (LaneWords)(V[x] > V[y]));
+                    V[x] = BLEND(V[x], (V[x] - V[y]) & 0xFF, m);
+                    break;
+                case 0x6:
+                    V[0xF] = BLEND(V[0xF], V[x] & 1, m);
+                    V[x] = BLEND(V[x], V[x] >> 1, m);
+                    break;
+                case 0x7:
+                    V[0xF] = BLEND(V[0xF], zero, m);
+                    V[0xF] = BLEND(V[0xF], zero + 1, m & (LaneWords)(V[y] > V[x]));
+                    V[x] = BLEND(V[x], (V[y] - V[x]) & 0xFF, m);
+                    break;
+                case 0xE:
+                    V[0xF] = BLEND(V[0xF], V[x] >> 7, m);
+                    V[x] = BLEND(V[x], (V[x] << 1) & 0xFF, m);
+                    break;
+                default:
+                    return 0;
+            }
+            break;
+        case 0xA000:
+            group->I = BLEND(group->I, zero + nnn, m);
+            break;
+        case 0xB000:
+            group->pc = BLEND(group->pc, V[0] + nnn, m);
+            return 1;
+        case 0xC000:
+            for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                V[x][lane] = nextRandom(instances[lane]) & kk;
+            }
+            break;
+        case 0xD000:
+            for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                CHIP8* chip8 = instances[lane];
+                chip8->V[x] = V[x][lane];
+                chip8->V[y] = V[y][lane];
+                chip8->I = group->I[lane];
+                drawSprite(chip8, x, y, opcode & 0x000F);
+                V[0xF][lane] = chip8->V[0xF];
+            }
+            break;
+        case 0xE000:
+            if (kk != 0x9E && kk != 0xA1)
+                return 0;
+            for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                int lane = __builtin_ctz(bits);
+                group->pc[lane] += (!instances[lane]->keyboard[V[x][lane]] == (kk == 0xA1)) ? 4 : 2;
+            }
+            return 1;
+        case 0xF000:
+            switch(kk) {
+                case 0x07: V[x] = BLEND(V[x], group->delayTimer, m); break;
+                case 0x15: group->delayTimer = BLEND(group->delayTimer, V[x], m); break;
+                case 0x18: group->soundTimer = BLEND(group->soundTimer, V[x], m); break;
+                case 0x1E: group->I += V[x] & m; break;
+                case 0x29: group->I = BLEND(group->I, V[x] * 5 + 0x50, m); break;
+                case 0x65:
+                    for (unsigned int bits = lanes; bits; bits &= bits - 1) {
+                        int lane = __builtin_ctz(bits);
+                        for (int i = 0; i <= x; i++)
+                            V[i][lane] = instances[lane]->memory[group->I[lane] + i];
+                    }
+                    break;
+                default:
+                    return 0;
+            }
+            break;
+        default:
+            return 0;
+    }
+
+    group->pc += 2 & m;
+    return 1;
+
+skipNext:
+    group->pc += (2 + (skip & 2)) & m;
+    return 1;
+}
+
+ALWAYS_INLINE void step(LaneGroup* group) {
+    // one instruction on every active lane
+    LaneMask pending = group->active;
+    unsigned int remaining = laneBits(&pending);
+    unsigned int scalar = 0;
+
+    while (remaining) {
+        // lead with the first lane not run yet; every other pending lane at the same pc joins it
+        // (even a group of one is cheaper as a vector step than a trip through emulateCycle)
+        int leader = __builtin_ctz(remaining);
+        unsigned short pc = group->pc[leader];
+        LaneMask same = (group->pc == pc) & pending;
+        unsigned int followers = laneBits(&same);
+        remaining &= ~followers;
+        pending &= ~same;
+
+        if (pc >= MEMORY_SIZE - 1 || group->divergentCode[pc] || group->divergentCode[pc + 1]) {
+            scalar |= followers;
+            continue;
+        }
+        const unsigned char* memory = group->instances[leader]->memory;
+        unsigned short opcode = (memory[pc] << 8) | memory[pc + 1];
+        if (stepVector(group, opcode, &same, followers)) {
+            group->vectorSteps++;
+            group->vectorInstructions += __builtin_popcount(followers);
+        } else
+            scalar |= followers;
+    }
+
+    // the rest run on their own
+    while (scalar) {
+        int lane = __builtin_ctz(scalar);
+        scalar &= scalar - 1;
+        stepLane(group, lane);
+    }
+}
+
+ALWAYS_INLINE void tickTimers(LaneGroup* group) {
+    // same as updateTimers on every lane: count down whatever is not 0 yet (inactive lanes tick too, nobody reads them)
+    group->delayTimer += (LaneWords)(group->delayTimer != 0);
+    group->soundTimer += (LaneWords)(group->soundTimer != 0);
+}
+
+ALWAYS_INLINE void runSteps(LaneGroup* group, unsigned long cycles, unsigned int instructionsPerFrame) {
+    // whole frames first, then the rest, exactly like runCycles
+    for (unsigned long frame = 0; frame < cycles / instructionsPerFrame; frame++) {
+        for (unsigned int i = 0; i < instructionsPerFrame; i++)
+            step(group);
+        tickTimers(group);
+    }
+    for (unsigned long i = 0; i < cycles % instructionsPerFrame; i++)
+        step(group);
+}
+
+#ifdef BATCH_X86
+__attribute__((target("avx2")))
+static void runStepsAVX2(LaneGroup* group, unsigned long cycles, unsigned int instructionsPerFrame) {
+    runSteps(group, cycles, instructionsPerFrame);
+}
+#endif
+
+static void runStepsBaseline(LaneGroup* group, unsigned long cycles, unsigned int instructionsPerFrame) {
+    runSteps(group, cycles, instructionsPerFrame);
+}
+
+void runLockstep(LaneGroup* group, unsigned long cycles, unsigned int instructionsPerFrame) {
+    // run cycles instructions on every lane of a loaded group (storeLaneGroup puts the results back)
+#ifdef BATCH_X86
+    static int hasAVX2 = -1;
+    if (hasAVX2 < 0)
+        hasAVX2 = __builtin_cpu_supports("avx2");
+
+    if (hasAVX2) {
+        runStepsAVX2(group, cycles, instructionsPerFrame);
+        return;
+    }
+#endif
+    runStepsBaseline(group, cycles, instructionsPerFrame);
+}
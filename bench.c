@@ -0,0 +1,184 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/bench.h"
+
+#include <math.h>
+
+/*
+    - micro benchmarks: memory is filled with one opcode (plus a jump back), so every instruction executed is that opcode
+    - ROM benchmarks: each ROM runs headless for a fixed number of cycles from a fixed seed, so runs are comparable between builds
+    - every benchmark runs several times from the same starting state; the table on stdout and the CSV both carry the
+      mean ns/instruction, instructions/sec and the standard deviation over the runs
+*/
+
+// one entry per opcode family. Registers start at 0 (so the skips never skip), I starts at the font (so Dxyn draws a digit)
+static const MicroBenchmark microBenchmarks[] = {
+    { "00E0 CLS", 0x00E0 },
+    { "1nnn JP", 0x1200 },
+    { "2nnn/00EE CALL+RET", 0x0000 }, // special program, see setupMicroBenchmark
+    { "3xkk SE", 0x3101 },
+    { "4xkk SNE", 0x4100 },
+    { "5xy0 SE", 0x5120 },
+    { "6xkk LD", 0x6142 },
+    { "7xkk ADD", 0x7103 },
+    { "8xy0 LD", 0x8120 },
+    { "8xy1 OR", 0x8121 },
+    { "8xy2 AND", 0x8122 },
+    { "8xy3 XOR", 0x8123 },
+    { "8xy4 ADD", 0x8124 },
+    { "8xy5 SUB", 0x8125 },
+    { "8xy6 SHR", 0x8126 },
+    { "8xy7 SUBN", 0x8127 },
+    { "8xyE SHL", 0x812E },
+    { "9xy0 SNE", 0x9120 },
+    { "Annn LD I", 0xA050 },
+    { "Bnnn JP V0", 0xB200 },
+    { "Cxkk RND", 0xC1FF },
+    { "Dxyn DRW", 0xD125 },
+    { "Ex9E SKP", 0xE19E },
+    { "ExA1 SKNP", 0xE1A1 },
+    { "Fx07 LD Vx, DT", 0xF107 },
+    { "Fx0A LD Vx, K", 0xF10A },
+    { "Fx15 LD DT, Vx", 0xF115 },
+    { "Fx18 LD ST, Vx", 0xF118 },
+    { "Fx1E ADD I", 0xF11E },
+    { "Fx29 LD F", 0xF129 },
+    { "Fx33 LD B", 0xF133 },
+    { "Fx55 LD [I]", 0xF355 },
+    { "Fx65 LD Vx, [I]", 0xF365 }
+};
+
+int main(int argc, char *argv[]) {
+    unsigned long cycles = DEFAULT_BENCH_CYCLES;
+    int runs = DEFAULT_BENCH_RUNS;
+    unsigned int seed = DEFAULT_SEED;
+    const char* engineName = "interpreter";
+    const char* csvPath = NULL;
+
+    // parse the options, everything after them is a ROM path
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-c") == 0 && atol(argv[arg+1]) > 0)
+            cycles = atol(argv[arg+1]);
+        else if (strcmp(argv[arg], "-n") == 0 && atoi(argv[arg+1]) > 0)
+            runs = atoi(argv[arg+1]);
+        else if (strcmp(argv[arg], "-s") == 0)
+            seed = strtoul(argv[arg+1], NULL, 10);
+        else if (strcmp(argv[arg], "-e") == 0)
+            engineName = argv[arg+1];
+        else if (strcmp(argv[arg], "-o") == 0)
+            csvPath = argv[arg+1];
+        else
+            break;
+        arg += 2;
+    }
+
+    EngineType engineType;
+    if ((arg < argc && argv[arg][0] == '-') || !parseEngineType(engineName, &engineType)) {
+        fprintf(stderr, "Usage: ./benchmark [-c CYCLES] [-n RUNS] [-s SEED] [-e ENGINE] [-o CSV PATH] [ROM PATH]...\n");
+        exit(1);
+    }
+
+    Engine engine;
+    if (createEngine(&engine, engineType))
+        exit(1);
+
+    FILE* csv = NULL;
+    if (csvPath != NULL) {
+        csv = fopen(csvPath, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "Error opening %s\n", csvPath);
+            exit(1);
+        }
+        fprintf(csv, "kind,name,engine,cycles,runs,ns_per_instruction,stddev_ns,instructions_per_second\n");
+    }
+
+    printf("%-8s %-22s %12s %10s %16s\n", "kind", "name", "ns/instr", "stddev", "instr/sec");
+
+    // per-opcode microbenchmarks (no timer ticks, just the instruction)
+    CHIP8 chip8;
+    for (size_t i = 0; i < sizeof(microBenchmarks) / sizeof(microBenchmarks[0]); i++) {
+        setupMicroBenchmark(&chip8, microBenchmarks[i].opcode);
+        seedRandom(&chip8, seed);
+        BenchResult result = measure(&engine, &chip8, cycles, runs, 0);
+        report(csv, "opcode", microBenchmarks[i].name, engineName, cycles, runs, result);
+    }
+
+    // whole ROMs, paced like a real run (timers tick every DEFAULT_INSTRUCTIONS_PER_FRAME instructions)
+    for (; arg < argc; arg++) {
+        initializeEmulator(&chip8);
+        if (loadROM(&chip8, argv[arg]))
+            continue;
+        seedRandom(&chip8, seed);
+        if (engineType == ENGINE_AOT && loadAotModule(engine.aot, argv[arg])) // micro benchmarks are interpreted
+            continue;
+
+        const char* name = strrchr(argv[arg], '/') != NULL ? strrchr(argv[arg], '/') + 1 : argv[arg];
+        BenchResult result = measure(&engine, &chip8, cycles, runs, DEFAULT_INSTRUCTIONS_PER_FRAME);
+        report(csv, "rom", name, engineName, cycles, runs, result);
+    }
+
+    if (csv != NULL)
+        fclose(csv);
+    destroyEngine(&engine);
+    return 0;
+}
+
+BenchResult measure(Engine* engine, const CHIP8* start, unsigned long cycles, int runs, unsigned int instructionsPerFrame) {
+    // instructionsPerFrame = 0 runs the cycles back to back without ticking the timers
+    double sum = 0;
+    double sumOfSquares = 0;
+    CHIP8 chip8;
+
+    for (int run = 0; run < runs; run++) {
+        chip8 = *start;
+        resetEngine(engine); // every run starts cold, like the first
+
+        unsigned long long startTime = monotonicNanoseconds();
+        if (instructionsPerFrame > 0)
+            runCycles(engine, &chip8, cycles, instructionsPerFrame);
+        else
+            runInstructions(engine, &chip8, cycles);
+        double ns = (double)(monotonicNanoseconds() - startTime) / cycles;
+
+        sum += ns;
+        sumOfSquares += ns * ns;
+    }
+
+    BenchResult result;
+    result.nsPerInstruction = sum / runs;
+    double variance = sumOfSquares / runs - result.nsPerInstruction * result.nsPerInstruction;
+    result.stddev = variance > 0 ? sqrt(variance) : 0;
+    result.instructionsPerSecond = 1e9 / result.nsPerInstruction;
+    return result;
+}
+
+void setupMicroBenchmark(CHIP8* chip8, unsigned short opcode) {
+    initializeEmulator(chip8);
+    chip8->I = 0x50; // the font, for Dxyn (Fx33/Fx55 write there too, which is harmless)
+
+    if (opcode == 0x0000) {
+        // CALL a subroutine that immediately returns, then jump back: 2 of every 3 instructions are CALL/RET
+        unsigned short program[] = { 0x2204, 0x1200, 0x00EE };
+        for (int i = 0; i < 3; i++) {
+            chip8->memory[MICRO_PROGRAM_START + 2 * i] = program[i] >> 8;
+            chip8->memory[MICRO_PROGRAM_START + 2 * i + 1] = program[i] & 0xFF;
+        }
+        return;
+    }
+
+    for (int address = MICRO_PROGRAM_START; address < MICRO_PROGRAM_END; address += 2) {
+        chip8->memory[address] = opcode >> 8;
+        chip8->memory[address + 1] = opcode & 0xFF;
+    }
+    chip8->memory[MICRO_PROGRAM_END] = 0x10 | (MICRO_PROGRAM_START >> 8);
+    chip8->memory[MICRO_PROGRAM_END + 1] = MICRO_PROGRAM_START & 0xFF;
+}
+
+void report(FILE* csv, const char* kind, const char* name, const char* engineName, unsigned long cycles, int runs, BenchResult result) {
+    printf("%-8s %-22s %12.2f %10.2f %16.0f\n", kind, name, result.nsPerInstruction, result.stddev, result.instructionsPerSecond);
+    if (csv != NULL)
+        fprintf(csv, "%s,%s,%s,%lu,%d,%.3f,%.3f,%.0f\n", kind, name, engineName, cycles, runs,
+            result.nsPerInstruction, result.stddev, result.instructionsPerSecond);
+}
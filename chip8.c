@@ -1,6 +1,18 @@
 #include "headers/chip8.h"
+#include "headers/profile.h"
+#include "headers/trace.h"
+#include "headers/quirks.h"
 
-void emulateCycle(CHIP8* chip8) {
+#include <string.h>
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+static void wrapSprite(CHIP8* chip8, unsigned short x, unsigned short y, unsigned short n);
+
+// the body of every interpreter. It is only ever inlined with record and quirks known at compile time: with record
+// a constant NULL the trace at the end compiles away, and every quirk test folds to one side, so the default
+// untraced copy (emulateCycle) is exactly what it was and the traced ones pay for a single store per instruction
+ALWAYS_INLINE void executeCycle(CHIP8* chip8, TraceRecord* record, const unsigned int quirks) {
     /* 
         - a cycle is just ONE opcode. Fetch it, decode it, execute it.
         - to fetch:
@@ -13,9 +25,9 @@ void emulateCycle(CHIP8* chip8) {
         - to execute:
             - see implementations in the switch cases below
     */
-    unsigned short opcode = (chip8->memory[chip8->pc] << 8) | chip8->memory[chip8->pc+1]; // fetch and decode
-
-    chip8->drawFlag = 0;
+    unsigned short pc = chip8->pc;
+    unsigned short opcode = (chip8->memory[pc] << 8) | chip8->memory[pc+1]; // fetch and decode
+    PROFILE_INSTRUCTION(chip8, opcode); // nothing unless built with -DCHIP8_PROFILE
 
     // x will always appear in the second position. This is an index.
     unsigned short x = (opcode & 0x0F00) >> 8; // 0x0F00 = 0000 1111 0000 0000 -> shift to the right 8 times to get just the index.
@@ -27,8 +39,7 @@ void emulateCycle(CHIP8* chip8) {
         case 0x0000:
             switch(opcode & 0x00FF) {
                 case 0x00E0: // CLS - clear the display
-                    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
-                        chip8->screen[i] = 0;
+                    clearScreen(chip8);
                     chip8->pc += 2;
                     break;
                 case 0x00EE: // RET - return from subroutine
@@ -105,8 +116,14 @@ void emulateCycle(CHIP8* chip8) {
                     chip8->pc += 2;
                     break;
                 case 0x0006: // 8xy6 - Set Vx = Vx SHR 1 (shift right 1)
-                    chip8->V[0xF] = (chip8->V[x] & 0x1);
-                    chip8->V[x] >>= 1;
+                    if (quirks & QUIRK_SHIFT_VY) { // Vx = Vy SHR 1, the flag last
+                        unsigned char source = chip8->V[y];
+                        chip8->V[x] = source >> 1;
+                        chip8->V[0xF] = source & 0x1;
+                    } else {
+                        chip8->V[0xF] = (chip8->V[x] & 0x1);
+                        chip8->V[x] >>= 1;
+                    }
                     chip8->pc += 2;
                     break;
                 case 0x0007: // 8xy7 - Set Vx = Vy - Vx, set VF = NOT borrow.
@@ -117,8 +134,14 @@ void emulateCycle(CHIP8* chip8) {
                     chip8->pc += 2;
                     break; 
                 case 0x000E: // 8xyE - Set Vx = Vx SHL 1.
-                    chip8->V[0xF] = (chip8->V[x] >> 7) & 0x1; // shifting to right 7 times puts most significant bit at the rightmost spot
-                    chip8->V[x] = (chip8->V[x] << 1);
+                    if (quirks & QUIRK_SHIFT_VY) { // Vx = Vy SHL 1, the flag last
+                        unsigned char source = chip8->V[y];
+                        chip8->V[x] = source << 1;
+                        chip8->V[0xF] = (source >> 7) & 0x1;
+                    } else {
+                        chip8->V[0xF] = (chip8->V[x] >> 7) & 0x1; // shifting to right 7 times puts most significant bit at the rightmost spot
+                        chip8->V[x] = (chip8->V[x] << 1);
+                    }
                     chip8->pc += 2;
                     break;                     
                 default:
@@ -136,34 +159,17 @@ void emulateCycle(CHIP8* chip8) {
             chip8->pc += 2;
             break;
         case 0xB000: // Bnnn - Jump to location nnn + V0.
-            chip8->pc = (opcode & 0x0FFF) + chip8->V[0];
+            chip8->pc = (opcode & 0x0FFF) + chip8->V[quirks & QUIRK_JUMP_VX ? x : 0]; // Bxnn: xnn + Vx
             break;
         case 0xC000: // Cxkk - Set Vx = random byte AND kk.
-            chip8->V[x] = (rand() % 256) & (opcode & 0x00FF);
+            chip8->V[x] = nextRandom(chip8) & (opcode & 0x00FF);
             chip8->pc += 2;
             break;
         case 0xD000: // Dxyn - Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision.
-            // given a sprite (the bytes for which are located at memory[I]), go thru the 8 bits of each of its bytes
-            // if this bit is a 1, do screen pixel ^= 0xFFFFFFFFFF (which is just xoring it by 1)
-            chip8->drawFlag = 1;
-            chip8->V[0xF] = 0;
-            unsigned char xPos = chip8->V[x] % SCREEN_WIDTH;
-            unsigned char yPos = chip8->V[y] % SCREEN_HEIGHT;
-            unsigned short spriteByte;
-
-            // the first row of the sprite is located at memory[i], second row located at memory[i+1], etc. [each row is a byte]
-            for (int row = 0; row < (opcode & 0x000F); row++) { 
-                spriteByte = chip8->memory[chip8->I + row]; // gets the start of the rowth byte in the sprite
-                for (int col = 0; col < 8; col++) { // go thru all the 8 bits in this byte of the sprite (shift spriteByte i bits to right then do & 1 to get the ith bit)
-                    unsigned char spritePixel = (spriteByte >> (7 - col)) & 0x01; // 1001 1010
-                    unsigned int* screenPixel = &chip8->screen[(yPos + row) * SCREEN_WIDTH + (xPos + col)]; // get what's currently at the position we need to be at
-                    if (spritePixel) { // if the spritePixel is on
-                        if (*screenPixel)
-                            chip8->V[0xF] = 1;
-                        *screenPixel ^= 0xFFFFFFFF;
-                    }
-                }
-            }
+            if (quirks & QUIRK_WRAP_SPRITES)
+                wrapSprite(chip8, x, y, opcode & 0x000F);
+            else
+                drawSprite(chip8, x, y, opcode & 0x000F);
             chip8->pc += 2;
             break;
         case 0xE000:
@@ -226,11 +232,19 @@ void emulateCycle(CHIP8* chip8) {
                 case 0x0055: // Fx55 - Store registers V0 through Vx in memory starting at location I.
                     for (int i = 0; i <= x; i++)
                         chip8->memory[chip8->I+i] = chip8->V[i];
+                    if (quirks & QUIRK_INCREMENT_I)
+                        chip8->I += x + 1;
+                    if (quirks & QUIRK_INCREMENT_I_BY_X)
+                        chip8->I += x;
                     chip8->pc += 2;
                     break;
                 case 0x0065: // Fx65 - Read registers V0 through Vx from memory starting at location I.
                     for (int i = 0; i <= x; i++)
                         chip8->V[i] = chip8->memory[chip8->I+i];
+                    if (quirks & QUIRK_INCREMENT_I)
+                        chip8->I += x + 1;
+                    if (quirks & QUIRK_INCREMENT_I_BY_X)
+                        chip8->I += x;
                     chip8->pc += 2;
                     break;
                 default:
@@ -239,6 +253,124 @@ void emulateCycle(CHIP8* chip8) {
             }
     }
 
+    if (record != NULL) {
+        TraceRecord traced = { pc, opcode, chip8->I, chip8->V[x], chip8->V[0xF] };
+        *record = traced;
+    }
+}
+
+void emulateCycle(CHIP8* chip8) {
+    executeCycle(chip8, NULL, DEFAULT_QUIRKS);
+}
+
+ALWAYS_INLINE void traceCycles(CHIP8* chip8, TraceRing* trace, unsigned long cycles, const unsigned int quirks,
+        void (*run)(CHIP8*, unsigned long)) {
+    // cycles instructions, with a record of each in trace for as many as it has room for (run does the rest).
+    // The position in the ring stays in a register for the whole run, and is handed over once at the end
+    unsigned long traced = reserveTrace(trace, cycles);
+    unsigned long long head = trace->head;
+    for (unsigned long i = 0; i < traced; i++)
+        executeCycle(chip8, &trace->records[(head + i) & (TRACE_RING_RECORDS - 1)], quirks);
+    run(chip8, cycles - traced);
+    publishTrace(trace, traced);
+}
+
+// one interpreter per profile, each with its quirks compiled in
+#define INTERPRETER(name, quirks) \
+    static void run##name(CHIP8* chip8, unsigned long cycles) { \
+        for (unsigned long i = 0; i < cycles; i++) \
+            executeCycle(chip8, NULL, quirks); \
+    } \
+    static void trace##name(CHIP8* chip8, TraceRing* trace, unsigned long cycles) { \
+        traceCycles(chip8, trace, cycles, quirks, run##name); \
+    }
+
+INTERPRETER(Default, DEFAULT_QUIRKS)
+INTERPRETER(VIP, VIP_QUIRKS)
+INTERPRETER(CHIP48, CHIP48_QUIRKS)
+INTERPRETER(SCHIP, SCHIP_QUIRKS)
+INTERPRETER(XOCHIP, XOCHIP_QUIRKS)
+
+static const Interpreter interpreters[NUM_QUIRK_PROFILES] = {
+    { "default", DEFAULT_QUIRKS, runDefault, traceDefault },
+    { "vip", VIP_QUIRKS, runVIP, traceVIP },
+    { "chip48", CHIP48_QUIRKS, runCHIP48, traceCHIP48 },
+    { "schip", SCHIP_QUIRKS, runSCHIP, traceSCHIP },
+    { "xochip", XOCHIP_QUIRKS, runXOCHIP, traceXOCHIP }
+};
+
+const Interpreter* selectInterpreter(QuirkProfile profile) {
+    return &interpreters[profile];
+}
+
+int parseQuirkProfile(const char* name, QuirkProfile* profile) {
+    for (int i = 0; i < NUM_QUIRK_PROFILES; i++) {
+        if (strcmp(name, interpreters[i].name) == 0) {
+            *profile = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void clearScreen(CHIP8* chip8) {
+    for (int row = 0; row < SCREEN_HEIGHT; row++)
+        chip8->screen[row] = 0;
+    chip8->drawFlag = 1;
+}
+
+void drawSprite(CHIP8* chip8, unsigned short x, unsigned short y, unsigned short n) {
+    // each byte of the sprite (the bytes for which are located at memory[I]) is one row of 8 pixels. Shift it into place
+    // within the 64-bit row word, then one AND tells us about a collision and one XOR draws the whole row
+    // sprites are clipped at the right and bottom edges of the screen
+    chip8->drawFlag = 1;
+    chip8->V[0xF] = 0;
+    unsigned char xPos = chip8->V[x] % SCREEN_WIDTH;
+    unsigned char yPos = chip8->V[y] % SCREEN_HEIGHT;
+
+    // the first row of the sprite is located at memory[i], second row located at memory[i+1], etc. [each row is a byte]
+    for (int row = 0; row < n && yPos + row < SCREEN_HEIGHT; row++) {
+        unsigned long long spriteRow = ((unsigned long long)chip8->memory[chip8->I + row] << 56) >> xPos; // bits past the right edge fall off
+        unsigned long long* screenRow = &chip8->screen[yPos + row];
+        if (*screenRow & spriteRow)
+            chip8->V[0xF] = 1;
+        *screenRow ^= spriteRow;
+    }
+}
+
+static void wrapSprite(CHIP8* chip8, unsigned short x, unsigned short y, unsigned short n) {
+    // drawSprite, but the pixels past the right edge come back in on the left and rows past the bottom on the top
+    chip8->drawFlag = 1;
+    chip8->V[0xF] = 0;
+    unsigned char xPos = chip8->V[x] % SCREEN_WIDTH;
+    unsigned char yPos = chip8->V[y] % SCREEN_HEIGHT;
+
+    for (int row = 0; row < n; row++) {
+        unsigned long long spriteRow = (unsigned long long)chip8->memory[(chip8->I + row) & (MEMORY_SIZE - 1)] << 56;
+        spriteRow = xPos ? (spriteRow >> xPos) | (spriteRow << (SCREEN_WIDTH - xPos)) : spriteRow; // rotate, not shift
+        unsigned long long* screenRow = &chip8->screen[(yPos + row) % SCREEN_HEIGHT];
+        if (*screenRow & spriteRow)
+            chip8->V[0xF] = 1;
+        *screenRow ^= spriteRow;
+    }
+}
+
+void seedRandom(CHIP8* chip8, unsigned int seed) {
+    chip8->rngState = seed != 0 ? seed : DEFAULT_SEED; // xorshift gets stuck at 0
+}
+
+unsigned char nextRandom(CHIP8* chip8) {
+    // xorshift32: the whole generator state lives in the instance, so instances never share (or lock) a global rand()
+    unsigned int state = chip8->rngState;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    chip8->rngState = state;
+    return state >> 24;
+}
+
+void updateTimers(CHIP8* chip8) {
+    // called once per 60Hz frame by the scheduler (not once per instruction) so the timers count real time
     if (chip8->soundTimer > 0)
         chip8->soundTimer -= 1;
     
@@ -277,9 +409,9 @@ void initializeEmulator(CHIP8* chip8) {
     chip8->I = 0; // index register starts at top of stack
     chip8->drawFlag = 0;
 
-    // clear the display: (go thru all the pixels and set them to 0)
-    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++)
-        chip8->screen[i] = 0;
+    // clear the display: (go thru all the rows and set them to 0)
+    for (int row = 0; row < SCREEN_HEIGHT; row++)
+        chip8->screen[row] = 0;
 
     // clear the stack, registers, and keyboard
     for (int i = 0; i < STACK_SIZE; i++) {
@@ -319,4 +451,6 @@ void initializeEmulator(CHIP8* chip8) {
     // reset the timers
     chip8->soundTimer = 0;
     chip8->delayTimer = 0;
+
+    seedRandom(chip8, DEFAULT_SEED);
 }
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "headers/chip8.h"
+#include "headers/recording.h"
+#include "headers/stream.h"
+#include "headers/client.h"
+
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+    - a stand-in for a remote viewer of ./server: subscribes to one instance, holds the given keys, and applies
+      the frames it is sent to its own copy of the screen
+    - stops after -f frames or -t seconds and reports how much came over the socket, plus the hash of the last
+      screen (same as ./replay's), which is how to check the stream against a run of the ROM elsewhere
+*/
+
+int main(int argc, char *argv[]) {
+    const char* socketPath = DEFAULT_SOCKET_PATH;
+    int instance = 0;
+    unsigned int keys = 0;
+    unsigned long maxFrames = 0;
+    double maxSeconds = 0;
+    int verbose = 0;
+
+    int arg = 1;
+    while (arg < argc) {
+        if (strcmp(argv[arg], "-v") == 0) {
+            verbose = 1;
+            arg++;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            fprintf(stderr, "Usage: ./client [-p SOCKET PATH] [-i INSTANCE] [-k KEY MASK (hex)] [-f FRAMES] [-t SECONDS] [-v]\n");
+            exit(1);
+        }
+        if (strcmp(argv[arg], "-p") == 0) {
+            socketPath = argv[arg+1];
+        } else if (strcmp(argv[arg], "-i") == 0) {
+            instance = atoi(argv[arg+1]);
+        } else if (strcmp(argv[arg], "-k") == 0) {
+            keys = strtoul(argv[arg+1], NULL, 16) & 0xFFFF;
+        } else if (strcmp(argv[arg], "-f") == 0) {
+            maxFrames = strtoul(argv[arg+1], NULL, 10);
+        } else if (strcmp(argv[arg], "-t") == 0) {
+            maxSeconds = atof(argv[arg+1]);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    int fd = connectToServer(socketPath);
+    if (fd < 0)
+        exit(1);
+
+    unsigned char payload[2];
+    put16(payload, keys);
+    if (sendMessage(fd, MESSAGE_SUBSCRIBE, instance, payload, 0) || sendMessage(fd, MESSAGE_KEYS, instance, payload, 2)) {
+        fprintf(stderr, "Lost the connection to %s\n", socketPath);
+        exit(1);
+    }
+
+    static MessageReader reader;
+    initializeReader(&reader);
+    unsigned long long screen[SCREEN_HEIGHT];
+    memset(screen, 0, sizeof(screen));
+    unsigned long frames = 0;
+    unsigned long long bytes = 0;
+    unsigned int lastFrame = 0;
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double seconds = 0;
+
+    while ((maxFrames == 0 || frames < maxFrames) && (maxSeconds == 0 || seconds < maxSeconds)) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, POLL_INTERVAL_MS);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        seconds = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+        if (ready <= 0)
+            continue;
+
+        int before = reader.length - reader.start;
+        if (!receiveMessages(&reader, fd)) {
+            printf("Server closed the connection\n");
+            break;
+        }
+        bytes += reader.length - before;
+
+        Message message;
+        while (nextMessage(&reader, &message)) {
+            if (message.type == MESSAGE_INFO && message.length >= 4) {
+                printf("Server runs %u instance(s) at %u instructions per frame\n", get16(message.payload), get16(message.payload + 2));
+                continue;
+            }
+            if (message.type != MESSAGE_FRAME || message.instance != instance || message.length < FRAME_HEADER_SIZE)
+                continue;
+
+            unsigned long long next[SCREEN_HEIGHT];
+            if (decodeDelta((const unsigned char*)screen, message.payload + FRAME_HEADER_SIZE,
+                    message.length - FRAME_HEADER_SIZE, (unsigned char*)next, SCREEN_BYTES)) {
+                fprintf(stderr, "Malformed frame from the server\n");
+                exit(1);
+            }
+            memcpy(screen, next, sizeof(screen));
+            lastFrame = get32(message.payload);
+            frames++;
+            if (verbose)
+                printScreen(screen);
+        }
+    }
+    close(fd);
+
+    printf("%lu frames received in %.1f s: %llu bytes (%.1f bytes/sec), last was frame %u, screen hash %016llx\n",
+        frames, seconds, bytes, seconds > 0 ? bytes / seconds : 0.0, lastFrame, hashScreen(screen));
+    return 0;
+}
+
+int connectToServer(const char* path) {
+    // returns the connected socket, or -1
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        fprintf(stderr, "Error connecting to %s\n", path);
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void printScreen(const unsigned long long* screen) {
+    // two rows per line of text, so the whole screen fits a terminal
+    for (int row = 0; row < SCREEN_HEIGHT; row += 2) {
+        char line[SCREEN_WIDTH + 1];
+        for (int x = 0; x < SCREEN_WIDTH; x++) {
+            int top = (screen[row] >> (63 - x)) & 1;
+            int bottom = (screen[row + 1] >> (63 - x)) & 1;
+            line[x] = top && bottom ? '8' : top ? '\'' : bottom ? '.' : ' ';
+        }
+        line[SCREEN_WIDTH] = '\0';
+        printf("|%s|\n", line);
+    }
+    printf("\n");
+}
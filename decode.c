@@ -0,0 +1,283 @@
+#include "headers/chip8.h"
+#include "headers/decode.h"
+
+#include <string.h>
+
+void clearDecodeCache(DecodeCache* cache) {
+    // OP_UNDECODED is 0, so this marks every slot as needing a decode
+    memset(cache->ops, 0, sizeof(cache->ops));
+}
+
+void invalidateDecodeCache(DecodeCache* cache, unsigned short address, unsigned short length) {
+    // the op at address - 1 reads the first written byte as its second half, so it goes stale too
+    for (int i = -1; i < length; i++)
+        cache->ops[(address + i) & (MEMORY_SIZE - 1)].handler = OP_UNDECODED;
+}
+
+Op decodeOp(const unsigned char* memory, unsigned short address) {
+    // same fetch and field extraction as emulateCycle, done once per slot instead of once per execution
+    unsigned short opcode = (memory[address] << 8) | memory[(address + 1) & (MEMORY_SIZE - 1)];
+    Op op;
+    op.x = (opcode & 0x0F00) >> 8;
+    op.y = (opcode & 0x00F0) >> 4;
+    op.kk = opcode & 0x00FF;
+    op.nnn = opcode & 0x0FFF;
+    op.handler = OP_FALLBACK;
+
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            if (op.kk == 0xE0)
+                op.handler = OP_CLS;
+            else if (op.kk == 0xEE)
+                op.handler = OP_RET;
+            break;
+        case 0x1000: op.handler = OP_JP; break;
+        case 0x2000: op.handler = OP_CALL; break;
+        case 0x3000: op.handler = OP_SE_BYTE; break;
+        case 0x4000: op.handler = OP_SNE_BYTE; break;
+        case 0x5000: op.handler = OP_SE_REG; break;
+        case 0x6000: op.handler = OP_LD_BYTE; break;
+        case 0x7000: op.handler = OP_ADD_BYTE; break;
+        case 0x8000:
+            switch(opcode & 0x000F) {
+                case 0x0000: op.handler = OP_LD_REG; break;
+                case 0x0001: op.handler = OP_OR; break;
+                case 0x0002: op.handler = OP_AND; break;
+                case 0x0003: op.handler = OP_XOR; break;
+                case 0x0004: op.handler = OP_ADD_REG; break;
+                case 0x0005: op.handler = OP_SUB; break;
+                case 0x0006: op.handler = OP_SHR; break;
+                case 0x0007: op.handler = OP_SUBN; break;
+                case 0x000E: op.handler = OP_SHL; break;
+            }
+            break;
+        case 0x9000: op.handler = OP_SNE_REG; break;
+        case 0xA000: op.handler = OP_LD_I; break;
+        case 0xB000: op.handler = OP_JP_V0; break;
+        case 0xC000: op.handler = OP_RND; break;
+        case 0xD000: op.handler = OP_DRW; break;
+        case 0xE000:
+            if (op.kk == 0x9E)
+                op.handler = OP_SKP;
+            else if (op.kk == 0xA1)
+                op.handler = OP_SKNP;
+            break;
+        case 0xF000:
+            switch(op.kk) {
+                case 0x07: op.handler = OP_LD_VX_DT; break;
+                case 0x0A: op.handler = OP_LD_VX_K; break;
+                case 0x15: op.handler = OP_LD_DT; break;
+                case 0x18: op.handler = OP_LD_ST; break;
+                case 0x1E: op.handler = OP_ADD_I; break;
+                case 0x29: op.handler = OP_LD_F; break;
+                case 0x33: op.handler = OP_LD_B; break;
+                case 0x55: op.handler = OP_LD_I_VX; break;
+                case 0x65: op.handler = OP_LD_VX_I; break;
+            }
+            break;
+    }
+
+    return op;
+}
+
+void runPredecoded(CHIP8* chip8, DecodeCache* cache, unsigned long cycles) {
+    /*
+        - same instructions as emulateCycle, but dispatched with computed gotos through a table of labels
+        - each handler jumps straight to the next one (no return to a loop, no nested switches),
+          and the fields of each instruction come from the cache instead of being re-extracted every time
+        - any write into memory (Fx33, Fx55) invalidates the slots it touched, so self-modifying code is re-decoded
+    */
+    static void* handlers[NUM_OPS] = {
+        [OP_UNDECODED] = &&undecoded,
+        [OP_CLS] = &&cls, [OP_RET] = &&ret, [OP_JP] = &&jp, [OP_CALL] = &&call,
+        [OP_SE_BYTE] = &&seByte, [OP_SNE_BYTE] = &&sneByte, [OP_SE_REG] = &&seReg,
+        [OP_LD_BYTE] = &&ldByte, [OP_ADD_BYTE] = &&addByte,
+        [OP_LD_REG] = &&ldReg, [OP_OR] = &&orReg, [OP_AND] = &&andReg, [OP_XOR] = &&xorReg,
+        [OP_ADD_REG] = &&addReg, [OP_SUB] = &&sub, [OP_SHR] = &&shr, [OP_SUBN] = &&subn, [OP_SHL] = &&shl,
+        [OP_SNE_REG] = &&sneReg, [OP_LD_I] = &&ldI, [OP_JP_V0] = &&jpV0, [OP_RND] = &&rnd, [OP_DRW] = &&drw,
+        [OP_SKP] = &&skp, [OP_SKNP] = &&sknp,
+        [OP_LD_VX_DT] = &&ldVxDt, [OP_LD_VX_K] = &&ldVxK, [OP_LD_DT] = &&ldDt, [OP_LD_ST] = &&ldSt,
+        [OP_ADD_I] = &&addI, [OP_LD_F] = &&ldF, [OP_LD_B] = &&ldB, [OP_LD_I_VX] = &&ldIVx, [OP_LD_VX_I] = &&ldVxI,
+        [OP_FALLBACK] = &&fallback
+    };
+
+    // pc lives in a local for the whole run (V is a char pointer that could alias chip8->pc, which would force
+    // a reload and store of pc around every register write); it is written back before anything that reads it
+    unsigned char* V = chip8->V;
+    Op* ops = cache->ops;
+    unsigned short pc = chip8->pc;
+    Op* op;
+
+    #define NEXT() \
+        do { \
+            if (cycles-- == 0) { \
+                chip8->pc = pc; \
+                return; \
+            } \
+            op = &ops[pc & (MEMORY_SIZE - 1)]; \
+            goto *handlers[op->handler]; \
+        } while (0)
+
+    NEXT();
+
+undecoded: // first time this slot is executed (or it was written to): decode it, then run it
+    *op = decodeOp(chip8->memory, pc & (MEMORY_SIZE - 1));
+    goto *handlers[op->handler];
+
+cls:
+    clearScreen(chip8);
+    pc += 2;
+    NEXT();
+ret:
+    chip8->sp--;
+    pc = chip8->stack[chip8->sp] + 2;
+    NEXT();
+jp:
+    pc = op->nnn;
+    NEXT();
+call:
+    chip8->stack[chip8->sp] = pc;
+    chip8->sp += 1;
+    pc = op->nnn;
+    NEXT();
+seByte:
+    pc += (V[op->x] == op->kk) ? 4 : 2;
+    NEXT();
+sneByte:
+    pc += (V[op->x] != op->kk) ? 4 : 2;
+    NEXT();
+seReg:
+    pc += (V[op->x] == V[op->y]) ? 4 : 2;
+    NEXT();
+ldByte:
+    V[op->x] = op->kk;
+    pc += 2;
+    NEXT();
+addByte:
+    V[op->x] += op->kk;
+    pc += 2;
+    NEXT();
+ldReg:
+    V[op->x] = V[op->y];
+    pc += 2;
+    NEXT();
+orReg:
+    V[op->x] |= V[op->y];
+    pc += 2;
+    NEXT();
+andReg:
+    V[op->x] &= V[op->y];
+    pc += 2;
+    NEXT();
+xorReg:
+    V[op->x] ^= V[op->y];
+    pc += 2;
+    NEXT();
+addReg: // matches emulateCycle, which leaves VF = 0 whether or not the add carries
+    V[0xF] = 0;
+    V[op->x] += V[op->y];
+    pc += 2;
+    NEXT();
+sub: // VF is cleared before the compare, exactly like emulateCycle (it matters when x or y is F)
+    V[0xF] = 0;
+    if (V[op->x] > V[op->y])
+        V[0xF] = 1;
+    V[op->x] -= V[op->y];
+    pc += 2;
+    NEXT();
+shr:
+    V[0xF] = V[op->x] & 0x1;
+    V[op->x] >>= 1;
+    pc += 2;
+    NEXT();
+subn:
+    V[0xF] = 0;
+    if (V[op->y] > V[op->x])
+        V[0xF] = 1;
+    V[op->x] = V[op->y] - V[op->x];
+    pc += 2;
+    NEXT();
+shl:
+    V[0xF] = (V[op->x] >> 7) & 0x1;
+    V[op->x] = V[op->x] << 1;
+    pc += 2;
+    NEXT();
+sneReg:
+    pc += (V[op->x] != V[op->y]) ? 4 : 2;
+    NEXT();
+ldI:
+    chip8->I = op->nnn;
+    pc += 2;
+    NEXT();
+jpV0:
+    pc = op->nnn + V[0];
+    NEXT();
+rnd:
+    V[op->x] = nextRandom(chip8) & op->kk;
+    pc += 2;
+    NEXT();
+drw:
+    drawSprite(chip8, op->x, op->y, op->kk & 0x0F);
+    pc += 2;
+    NEXT();
+skp:
+    pc += chip8->keyboard[V[op->x]] ? 4 : 2;
+    NEXT();
+sknp:
+    pc += !chip8->keyboard[V[op->x]] ? 4 : 2;
+    NEXT();
+ldVxDt:
+    V[op->x] = chip8->delayTimer;
+    pc += 2;
+    NEXT();
+ldVxK:
+    for (int i = 0; i < KEYBOARD_SIZE; i++) {
+        if (chip8->keyboard[i]) {
+            V[op->x] = i;
+            break;
+        }
+    }
+    pc += 2;
+    NEXT();
+ldDt:
+    chip8->delayTimer = V[op->x];
+    pc += 2;
+    NEXT();
+ldSt:
+    chip8->soundTimer = V[op->x];
+    pc += 2;
+    NEXT();
+addI:
+    chip8->I += V[op->x];
+    pc += 2;
+    NEXT();
+ldF:
+    chip8->I = 0x50 + V[op->x] * 5;
+    pc += 2;
+    NEXT();
+ldB:
+    chip8->memory[chip8->I] = (V[op->x] % 1000) / 100;
+    chip8->memory[chip8->I+1] = (V[op->x] % 100) / 10;
+    chip8->memory[chip8->I+2] = (V[op->x] % 10);
+    invalidateDecodeCache(cache, chip8->I, 3);
+    pc += 2;
+    NEXT();
+ldIVx:
+    for (int i = 0; i <= op->x; i++)
+        chip8->memory[chip8->I+i] = V[i];
+    invalidateDecodeCache(cache, chip8->I, op->x + 1);
+    pc += 2;
+    NEXT();
+ldVxI:
+    for (int i = 0; i <= op->x; i++)
+        V[i] = chip8->memory[chip8->I+i];
+    pc += 2;
+    NEXT();
+fallback:
+    chip8->pc = pc;
+    emulateCycle(chip8);
+    pc = chip8->pc;
+    NEXT();
+
+    #undef NEXT
+}
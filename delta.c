@@ -0,0 +1,80 @@
+#include "headers/delta.h"
+
+#include <string.h>
+
+/*
+    - a delta is current XOR base, run-length encoded: the XOR is zero wherever nothing changed, so it is mostly zeros
+    - the encoding is a list of (number of zero bytes, number of literal bytes, the literal bytes), counts are 16-bit little endian
+*/
+
+static void put16(unsigned char* out, int value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+static int get16(const unsigned char* in) {
+    return in[0] | (in[1] << 8);
+}
+
+int encodeDelta(const unsigned char* base, const unsigned char* current, int size, unsigned char* out) {
+    // out must have room for DELTA_MAX_SIZE(size) bytes. Returns the encoded length
+    int length = 0;
+    int i = 0;
+    while (i < size) {
+        // skip unchanged bytes 8 at a time first, most of a frame's state is unchanged
+        int zeros = 0;
+        while (i + 8 <= size && zeros + 8 <= 0xFFFF) {
+            unsigned long long a, b;
+            memcpy(&a, base + i, 8);
+            memcpy(&b, current + i, 8);
+            if (a != b)
+                break;
+            zeros += 8;
+            i += 8;
+        }
+        while (i < size && zeros < 0xFFFF && base[i] == current[i]) {
+            zeros++;
+            i++;
+        }
+
+        // a literal run ends at the first unchanged byte (so short gaps cost at most 4 bytes of counts)
+        int literalStart = i;
+        while (i < size && i - literalStart < 0xFFFF && base[i] != current[i])
+            i++;
+        int literals = i - literalStart;
+
+        // nothing left to say once only unchanged bytes remain
+        if (literals == 0 && i == size)
+            break;
+
+        put16(out + length, zeros);
+        put16(out + length + 2, literals);
+        length += 4;
+        for (int j = 0; j < literals; j++)
+            out[length++] = base[literalStart + j] ^ current[literalStart + j];
+    }
+    return length;
+}
+
+int decodeDelta(const unsigned char* base, const unsigned char* in, int inLength, unsigned char* out, int size) {
+    // returns 0 on success, 1 if the delta is malformed
+    for (int i = 0; i < size; i++)
+        out[i] = base[i];
+
+    int position = 0;
+    int i = 0;
+    while (i < inLength) {
+        if (inLength - i < 4)
+            return 1;
+        int zeros = get16(in + i);
+        int literals = get16(in + i + 2);
+        i += 4;
+        if (position + zeros + literals > size || i + literals > inLength)
+            return 1;
+
+        position += zeros;
+        for (int j = 0; j < literals; j++)
+            out[position++] ^= in[i++];
+    }
+    return 0;
+}
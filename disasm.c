@@ -0,0 +1,71 @@
+#include "headers/chip8.h"
+#include "headers/disasm.h"
+
+void disassemble(unsigned short opcode, char* out, size_t size) {
+    // Cowgod's mnemonics, e.g. "LD V1, 0x2A" or "DRW V0, V1, 5"
+    unsigned short x = (opcode & 0x0F00) >> 8;
+    unsigned short y = (opcode & 0x00F0) >> 4;
+    unsigned short n = opcode & 0x000F;
+    unsigned short kk = opcode & 0x00FF;
+    unsigned short nnn = opcode & 0x0FFF;
+
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0)
+                snprintf(out, size, "CLS");
+            else if (opcode == 0x00EE)
+                snprintf(out, size, "RET");
+            else
+                snprintf(out, size, "SYS 0x%03X", nnn);
+            return;
+        case 0x1000: snprintf(out, size, "JP 0x%03X", nnn); return;
+        case 0x2000: snprintf(out, size, "CALL 0x%03X", nnn); return;
+        case 0x3000: snprintf(out, size, "SE V%X, 0x%02X", x, kk); return;
+        case 0x4000: snprintf(out, size, "SNE V%X, 0x%02X", x, kk); return;
+        case 0x5000: snprintf(out, size, "SE V%X, V%X", x, y); return;
+        case 0x6000: snprintf(out, size, "LD V%X, 0x%02X", x, kk); return;
+        case 0x7000: snprintf(out, size, "ADD V%X, 0x%02X", x, kk); return;
+        case 0x8000:
+            switch(n) {
+                case 0x0: snprintf(out, size, "LD V%X, V%X", x, y); return;
+                case 0x1: snprintf(out, size, "OR V%X, V%X", x, y); return;
+                case 0x2: snprintf(out, size, "AND V%X, V%X", x, y); return;
+                case 0x3: snprintf(out, size, "XOR V%X, V%X", x, y); return;
+                case 0x4: snprintf(out, size, "ADD V%X, V%X", x, y); return;
+                case 0x5: snprintf(out, size, "SUB V%X, V%X", x, y); return;
+                case 0x6: snprintf(out, size, "SHR V%X", x); return;
+                case 0x7: snprintf(out, size, "SUBN V%X, V%X", x, y); return;
+                case 0xE: snprintf(out, size, "SHL V%X", x); return;
+            }
+            break;
+        case 0x9000: snprintf(out, size, "SNE V%X, V%X", x, y); return;
+        case 0xA000: snprintf(out, size, "LD I, 0x%03X", nnn); return;
+        case 0xB000: snprintf(out, size, "JP V0, 0x%03X", nnn); return;
+        case 0xC000: snprintf(out, size, "RND V%X, 0x%02X", x, kk); return;
+        case 0xD000: snprintf(out, size, "DRW V%X, V%X, %d", x, y, n); return;
+        case 0xE000:
+            if (kk == 0x9E) {
+                snprintf(out, size, "SKP V%X", x);
+                return;
+            }
+            if (kk == 0xA1) {
+                snprintf(out, size, "SKNP V%X", x);
+                return;
+            }
+            break;
+        case 0xF000:
+            switch(kk) {
+                case 0x07: snprintf(out, size, "LD V%X, DT", x); return;
+                case 0x0A: snprintf(out, size, "LD V%X, K", x); return;
+                case 0x15: snprintf(out, size, "LD DT, V%X", x); return;
+                case 0x18: snprintf(out, size, "LD ST, V%X", x); return;
+                case 0x1E: snprintf(out, size, "ADD I, V%X", x); return;
+                case 0x29: snprintf(out, size, "LD F, V%X", x); return;
+                case 0x33: snprintf(out, size, "LD B, V%X", x); return;
+                case 0x55: snprintf(out, size, "LD [I], V%X", x); return;
+                case 0x65: snprintf(out, size, "LD V%X, [I]", x); return;
+            }
+            break;
+    }
+    snprintf(out, size, "DW 0x%04X", opcode); // not an instruction
+}
@@ -0,0 +1,113 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+
+#include <string.h>
+
+int createEngine(Engine* engine, EngineType type) {
+    engine->type = type;
+    engine->cache = NULL;
+    engine->jit = NULL;
+    engine->aot = NULL;
+    engine->trace = NULL;
+    engine->interpreter = selectInterpreter(QUIRKS_DEFAULT);
+    engine->idle.enabled = 0;
+    engine->idle.skipped = 0;
+    resetIdleDetector(&engine->idle);
+
+    if (type == ENGINE_PREDECODE) {
+        engine->cache = malloc(sizeof(DecodeCache));
+        if (engine->cache == NULL) {
+            fprintf(stderr, "Error allocating the decode cache\n");
+            return 1;
+        }
+        clearDecodeCache(engine->cache);
+    }
+
+    if (type == ENGINE_JIT) {
+        engine->jit = createJitCache();
+        if (engine->jit == NULL)
+            return 1;
+    }
+
+    if (type == ENGINE_AOT) {
+        engine->aot = createAotCache();
+        if (engine->aot == NULL)
+            return 1;
+    }
+
+    return 0;
+}
+
+void destroyEngine(Engine* engine) {
+    free(engine->cache);
+    engine->cache = NULL;
+    destroyJitCache(engine->jit);
+    engine->jit = NULL;
+    destroyAotCache(engine->aot);
+    engine->aot = NULL;
+}
+
+void resetEngine(Engine* engine) {
+    // forget everything cached about memory (call after memory was changed from outside the engine)
+    if (engine->cache != NULL)
+        clearDecodeCache(engine->cache);
+    if (engine->jit != NULL)
+        clearJitCache(engine->jit);
+    if (engine->aot != NULL)
+        resetAotCache(engine->aot);
+    resetIdleDetector(&engine->idle);
+}
+
+void invalidateEngine(Engine* engine, unsigned short address, unsigned short length) {
+    // forget what is cached about part of memory (call after changing just that part from outside the engine)
+    if (engine->cache != NULL)
+        invalidateDecodeCache(engine->cache, address, length);
+    if (engine->jit != NULL)
+        invalidateJitCache(engine->jit, address, length);
+    if (engine->aot != NULL)
+        invalidateAotCache(engine->aot, address, length);
+}
+
+void runInstructions(Engine* engine, CHIP8* chip8, unsigned long cycles) {
+    switch(engine->type) {
+        case ENGINE_INTERPRETER:
+            if (engine->trace != NULL)
+                engine->interpreter->trace(chip8, engine->trace, cycles);
+            else
+                engine->interpreter->run(chip8, cycles);
+            break;
+        case ENGINE_PREDECODE:
+            runPredecoded(chip8, engine->cache, cycles);
+            break;
+        case ENGINE_JIT:
+            runJit(chip8, engine->jit, cycles);
+            break;
+        case ENGINE_AOT:
+            runAot(chip8, engine->aot, cycles);
+            break;
+    }
+}
+
+int setQuirkProfile(Engine* engine, QuirkProfile profile) {
+    // the other engines (and the idle detector) only know the default behaviour
+    if (profile != QUIRKS_DEFAULT && (engine->type != ENGINE_INTERPRETER || engine->idle.enabled)) {
+        fprintf(stderr, "The %s quirks need the interpreter engine, without idle skipping\n", selectInterpreter(profile)->name);
+        return 1;
+    }
+    engine->interpreter = selectInterpreter(profile);
+    return 0;
+}
+
+int parseEngineType(const char* name, EngineType* type) {
+    if (strcmp(name, "interpreter") == 0)
+        *type = ENGINE_INTERPRETER;
+    else if (strcmp(name, "predecode") == 0)
+        *type = ENGINE_PREDECODE;
+    else if (strcmp(name, "jit") == 0)
+        *type = ENGINE_JIT;
+    else if (strcmp(name, "aot") == 0)
+        *type = ENGINE_AOT;
+    else
+        return 0;
+    return 1;
+}
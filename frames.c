@@ -0,0 +1,31 @@
+#include "headers/chip8.h"
+#include "headers/frames.h"
+
+#include <string.h>
+
+void initializeFrameBuffer(FrameBuffer* buffer) {
+    memset(buffer->screens, 0, sizeof(buffer->screens));
+    memset(buffer->tags, 0, sizeof(buffer->tags));
+    buffer->back = 0;
+    atomic_init(&buffer->middle, 1);
+    buffer->front = 2;
+}
+
+void publishFrame(FrameBuffer* buffer, const unsigned long long* screen, unsigned long long tag) {
+    // fill our slot, then trade it for the middle one (release: the reader must see the rows before the index)
+    memcpy(buffer->screens[buffer->back], screen, sizeof(buffer->screens[0]));
+    buffer->tags[buffer->back] = tag;
+    int previous = atomic_exchange_explicit(&buffer->middle, buffer->back | FRAME_FRESH, memory_order_acq_rel);
+    buffer->back = previous & ~FRAME_FRESH;
+}
+
+const unsigned long long* takeFrame(FrameBuffer* buffer, unsigned long long* tag) {
+    // returns the newest frame, or NULL if nothing was published since the last call. The frame stays valid until the next call
+    if (!(atomic_load_explicit(&buffer->middle, memory_order_relaxed) & FRAME_FRESH))
+        return NULL;
+
+    int previous = atomic_exchange_explicit(&buffer->middle, buffer->front, memory_order_acq_rel);
+    buffer->front = previous & ~FRAME_FRESH;
+    *tag = buffer->tags[buffer->front];
+    return buffer->screens[buffer->front];
+}
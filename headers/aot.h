@@ -0,0 +1,49 @@
+#ifndef AOT_H
+#define AOT_H
+
+#define AOT_ABI_VERSION 1
+#define AOT_MODULE_SYMBOL "chip8AotModule"
+#define ROM_START 0x200
+
+/*
+    - ./recompile turns a ROM into C ahead of time (see recompile.c); built with make <ROM>.so, the module is loaded
+      by the aot engine with dlopen. The same header is included by the generated code, so both sides agree on this layout
+    - the module calls back into the emulator through AotRuntime instead of linking against it, so it builds the
+      same way everywhere and can be loaded by any of the executables
+*/
+
+typedef struct {
+    void (*clearScreen)(CHIP8* chip8);
+    void (*drawSprite)(CHIP8* chip8, unsigned short x, unsigned short y, unsigned short n);
+    unsigned char (*nextRandom)(CHIP8* chip8);
+} AotRuntime;
+
+// runs up to budget instructions starting at chip8->pc and returns how many of the budget are left. It leaves at the
+// first instruction that is not compiled or whose enabled[] entry is 0, with pc, I and V written back to chip8
+typedef int (*AotRunFn)(CHIP8* chip8, const AotRuntime* runtime, const unsigned char* enabled, int budget);
+
+typedef struct {
+    int abiVersion; // AOT_ABI_VERSION the module was generated for
+    int stateSize; // sizeof(CHIP8) it was built against
+    const unsigned char* rom; // the bytes it was compiled from, loaded at ROM_START
+    int romSize;
+    const unsigned char* compiled; // MEMORY_SIZE entries, 1 where an instruction starts that the module can run
+    AotRunFn run;
+} AotModule;
+
+// engine side: a loaded module and which of its instructions still match memory
+typedef struct {
+    void* handle;
+    const AotModule* module; // NULL until loadAotModule (everything is interpreted until then)
+    unsigned char enabled[MEMORY_SIZE];
+    int synced; // enabled[] was worked out against the current memory
+} AotCache;
+
+AotCache* createAotCache();
+void destroyAotCache(AotCache* aot);
+int loadAotModule(AotCache* aot, const char* romPath);
+void resetAotCache(AotCache* aot);
+void invalidateAotCache(AotCache* aot, unsigned short address, unsigned short length);
+void runAot(CHIP8* chip8, AotCache* aot, unsigned long cycles);
+
+#endif
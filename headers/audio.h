@@ -0,0 +1,63 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+
+#define AUDIO_FREQUENCY 48000
+#define DEFAULT_AUDIO_BUFFER 512 // samples per callback: ~11 ms at 48kHz. Smaller is lower latency but risks underruns
+#define TONE_HZ 440
+#define TONE_VOLUME 3000 // out of 32767
+#define TONE_QUEUE_SIZE 64 // edges in flight between the emulation thread and the callback (a power of two)
+#define MAX_TONE_DELAY_FRAMES 2 // an edge that would play later than this is played straight away instead
+
+/*
+    - the beeper is a square wave that is on while the sound timer is non-zero. The emulation thread only reports
+      the frames where that changes; the edges go to the SDL audio callback through a single-producer single-consumer
+      ring, so neither side ever takes a lock
+    - the callback lays the edges out on its own sample clock as far apart as they were in emulated frames, so a
+      one-frame beep lasts one frame even if both edges arrive in the same buffer
+*/
+
+typedef struct {
+    unsigned long long frame; // emulated frame the edge happened at
+    unsigned long long time; // monotonic ns it was queued at, for the latency figures
+    int on;
+} ToneEdge;
+
+typedef struct {
+    SDL_AudioDeviceID device; // 0 if there is no audio (everything else is then a no-op)
+    int frequency;
+    int bufferSamples;
+    unsigned long long bufferNanoseconds;
+
+    // emulation thread
+    unsigned long long frame;
+    int on;
+    unsigned long long dropped; // edges lost to a full ring
+
+    // ring: head is written by the emulation thread, tail by the callback
+    ToneEdge edges[TONE_QUEUE_SIZE];
+    _Alignas(64) atomic_uint head;
+    _Alignas(64) atomic_uint tail;
+
+    // callback (read the figures below once the device is closed)
+    int playing;
+    unsigned int phase;
+    unsigned long long sampleClock; // samples written so far
+    unsigned long long lastEdge; // sample the last edge was played at
+    unsigned long long lastFrame; // and the frame it came from
+    unsigned long long lastCallback;
+    unsigned long long callbacks;
+    unsigned long long underruns; // callbacks that came more than half a buffer late, so the device ran dry in between
+    unsigned long long latencyTotal; // from an edge being queued to it leaving the device, in ns
+    unsigned long long latencyMax;
+    unsigned long long latencyCount;
+} Beeper;
+
+void openBeeper(Beeper* beeper, int bufferSamples);
+void closeBeeper(Beeper* beeper);
+void updateBeeper(Beeper* beeper, int on);
+void printBeeperStats(const Beeper* beeper);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#define BATCH_LANES 16 // instances per lockstep group: a register of every lane fills one AVX2 register
+
+// GCC/clang vector extensions: each element is one lane. They compile to AVX2 inside functions built for it
+// and to pairs of SSE2 registers (or plain loops) elsewhere, so there is one copy of the code for both.
+// Every register is kept in a 16-bit element, even the 8-bit ones (results are masked back to 8 bits), because
+// mixing element widths makes the compilers split and shuffle on every conversion
+typedef unsigned short LaneWords __attribute__((vector_size(BATCH_LANES * 2)));
+typedef short LaneMask __attribute__((vector_size(BATCH_LANES * 2))); // comparisons give 0 or -1 per lane
+
+/*
+    - the registers of BATCH_LANES instances in structure-of-arrays layout, so "V3 of every lane" is one vector
+    - memory, stack, keyboard, screen and the RNG stay in each lane's CHIP8; only the scalar path touches them
+    - instances must all be loaded with the same ROM for the vector path to be useful, but nothing breaks if they are
+      not: addresses where their memory differs are simply never run as vectors
+*/
+typedef struct {
+    LaneWords V[NUM_REGISTERS];
+    LaneWords I;
+    LaneWords pc;
+    LaneWords sp;
+    LaneWords delayTimer;
+    LaneWords soundTimer;
+    LaneMask active; // -1 for lanes that hold an instance
+    CHIP8* instances[BATCH_LANES];
+    int numLanes;
+    unsigned char divergentCode[MEMORY_SIZE]; // set where a lane's memory may differ from the others' (never fetched as a vector)
+    unsigned long long vectorSteps; // instructions run by the vector path (each for one or more lanes)
+    unsigned long long vectorInstructions; // lane-instructions run by the vector path
+    unsigned long long scalarInstructions; // and by emulateCycle
+} LaneGroup;
+
+void loadLaneGroup(LaneGroup* group, CHIP8* instances, int numLanes);
+void storeLaneGroup(LaneGroup* group);
+void runLockstep(LaneGroup* group, unsigned long cycles, unsigned int instructionsPerFrame);
+
+#endif
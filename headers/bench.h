@@ -0,0 +1,26 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string.h>
+
+#define DEFAULT_BENCH_CYCLES 2000000 // per run
+#define DEFAULT_BENCH_RUNS 5
+#define MICRO_PROGRAM_START 0x200
+#define MICRO_PROGRAM_END 0x300 // the opcode under test fills this range, followed by a jump back to the start
+
+typedef struct {
+    const char* name;
+    unsigned short opcode;
+} MicroBenchmark;
+
+typedef struct {
+    double nsPerInstruction; // mean over the runs
+    double stddev; // of ns/instruction over the runs
+    double instructionsPerSecond;
+} BenchResult;
+
+BenchResult measure(Engine* engine, const CHIP8* start, unsigned long cycles, int runs, unsigned int instructionsPerFrame);
+void setupMicroBenchmark(CHIP8* chip8, unsigned short opcode);
+void report(FILE* csv, const char* kind, const char* name, const char* engineName, unsigned long cycles, int runs, BenchResult result);
+
+#endif
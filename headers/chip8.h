@@ -4,8 +4,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
-#include <SDL2/SDL.h>
-#include <unistd.h>
 
 #define MEMORY_SIZE 4096
 #define NUM_REGISTERS 16
@@ -14,6 +12,7 @@
 #define SCREEN_WIDTH 64
 #define SCREEN_HEIGHT 32
 #define NUM_FONTS 80
+#define DEFAULT_SEED 1
 
 typedef struct {
     unsigned char memory[MEMORY_SIZE]; // 4k memory to work with
@@ -25,12 +24,18 @@ typedef struct {
     unsigned char sp; // stack pointer => points to the top of the stack
     unsigned short stack[STACK_SIZE]; // stores the address the interpreter should return to when done with a subroutine
     unsigned char keyboard[KEYBOARD_SIZE]; // 16 different keys
-    unsigned int screen[SCREEN_WIDTH * SCREEN_HEIGHT]; // use unsigned ints (32 bits) for screen instead of char to make working with SDL easier
-    unsigned char drawFlag;
+    unsigned long long screen[SCREEN_HEIGHT]; // one 64-bit word per row, bit 63 is the leftmost pixel (expanded to RGBA only when presenting, see screen.h)
+    unsigned char drawFlag; // set when the screen changes, cleared by whoever presents it
+    unsigned int rngState; // xorshift state behind Cxkk, so a run is reproducible from its seed
 } CHIP8;
 
 int loadROM(CHIP8* chip8, const char* filename);
 void initializeEmulator(CHIP8* chip8);
 void emulateCycle(CHIP8* chip8);
+void updateTimers(CHIP8* chip8);
+void seedRandom(CHIP8* chip8, unsigned int seed);
+unsigned char nextRandom(CHIP8* chip8);
+void clearScreen(CHIP8* chip8);
+void drawSprite(CHIP8* chip8, unsigned short x, unsigned short y, unsigned short n);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <poll.h>
+
+#define POLL_INTERVAL_MS 100 // how often to check the time limit while no frames arrive
+
+int connectToServer(const char* path);
+void printScreen(const unsigned long long* screen);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+// handlers for the predecoded engine, one per instruction (OP_UNDECODED marks a slot that still has to be decoded)
+enum {
+    OP_UNDECODED = 0,
+    OP_CLS, OP_RET, OP_JP, OP_CALL,
+    OP_SE_BYTE, OP_SNE_BYTE, OP_SE_REG, OP_LD_BYTE, OP_ADD_BYTE,
+    OP_LD_REG, OP_OR, OP_AND, OP_XOR, OP_ADD_REG, OP_SUB, OP_SHR, OP_SUBN, OP_SHL,
+    OP_SNE_REG, OP_LD_I, OP_JP_V0, OP_RND, OP_DRW, OP_SKP, OP_SKNP,
+    OP_LD_VX_DT, OP_LD_VX_K, OP_LD_DT, OP_LD_ST, OP_ADD_I, OP_LD_F, OP_LD_B, OP_LD_I_VX, OP_LD_VX_I,
+    OP_FALLBACK, // anything else (0nnn, unknown opcodes) is handed to emulateCycle so it behaves exactly as before
+    NUM_OPS
+};
+
+typedef struct {
+    unsigned char handler;
+    unsigned char x; // Vx index
+    unsigned char y; // Vy index
+    unsigned char kk; // low byte (n for Dxyn is kk & 0xF)
+    unsigned short nnn; // low 12 bits
+} Op;
+
+// one decoded op per byte of memory, since a jump can land on an odd address
+typedef struct {
+    Op ops[MEMORY_SIZE];
+} DecodeCache;
+
+void clearDecodeCache(DecodeCache* cache);
+void invalidateDecodeCache(DecodeCache* cache, unsigned short address, unsigned short length);
+Op decodeOp(const unsigned char* memory, unsigned short address);
+void runPredecoded(CHIP8* chip8, DecodeCache* cache, unsigned long cycles);
+
+#endif
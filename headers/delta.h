@@ -0,0 +1,10 @@
+#ifndef DELTA_H
+#define DELTA_H
+
+// worst case encoded size: alternating changed and unchanged bytes cost 5 bytes per 2
+#define DELTA_MAX_SIZE(size) ((size) * 5 / 2 + 4)
+
+int encodeDelta(const unsigned char* base, const unsigned char* current, int size, unsigned char* out);
+int decodeDelta(const unsigned char* base, const unsigned char* in, int inLength, unsigned char* out, int size);
+
+#endif
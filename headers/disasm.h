@@ -0,0 +1,8 @@
+#ifndef DISASM_H
+#define DISASM_H
+
+#include <stddef.h>
+
+void disassemble(unsigned short opcode, char* out, size_t size);
+
+#endif
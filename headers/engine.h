@@ -0,0 +1,38 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "decode.h"
+#include "jit.h"
+#include "aot.h"
+#include "idle.h"
+#include "trace.h"
+#include "quirks.h"
+
+typedef enum {
+    ENGINE_INTERPRETER, // emulateCycle (or its copy for another quirk profile), one instruction at a time
+    ENGINE_PREDECODE, // predecoded instruction cache with threaded dispatch
+    ENGINE_JIT, // x86-64 basic-block recompiler (emulateCycle for what it does not translate)
+    ENGINE_AOT // a module built ahead of time by ./recompile (loadAotModule), emulateCycle for what it does not cover
+} EngineType;
+
+// how one CHIP8 instance is executed. Engines with a cache must be invalidated whenever
+// memory changes outside of the instructions they run (loading a ROM, restoring state, ...)
+typedef struct {
+    EngineType type;
+    DecodeCache* cache;
+    JitCache* jit;
+    AotCache* aot;
+    IdleDetector idle; // used by runFrame when idle.enabled is set (off unless the caller turns it on)
+    TraceRing* trace; // interpreter only: every instruction it runs is recorded here (NULL unless the caller sets it)
+    const Interpreter* interpreter; // the interpreter for the quirk profile (setQuirkProfile), the default one unless set
+} Engine;
+
+int createEngine(Engine* engine, EngineType type);
+void destroyEngine(Engine* engine);
+void resetEngine(Engine* engine);
+void invalidateEngine(Engine* engine, unsigned short address, unsigned short length);
+void runInstructions(Engine* engine, CHIP8* chip8, unsigned long cycles);
+int setQuirkProfile(Engine* engine, QuirkProfile profile);
+int parseEngineType(const char* name, EngineType* type);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef FRAMES_H
+#define FRAMES_H
+
+#include <stdatomic.h>
+
+#define FRAME_SLOTS 3
+#define FRAME_FRESH 4 // flag on middle: the writer has put a frame there that the reader has not taken yet
+#define CACHE_LINE 64
+
+/*
+    - triple buffer between the emulation thread (writer) and the UI thread (reader): each side owns one slot, the
+      third sits in the middle and is swapped with a single atomic exchange, so neither side ever waits for the other
+    - the writer always has somewhere to draw and the reader always gets the newest frame; frames the reader was too
+      slow for are simply overwritten
+*/
+
+typedef struct {
+    unsigned long long screens[FRAME_SLOTS][SCREEN_HEIGHT];
+    unsigned long long tags[FRAME_SLOTS]; // whatever the writer wants to pass along with each frame
+    _Alignas(CACHE_LINE) atomic_int middle; // slot index, | FRAME_FRESH
+    _Alignas(CACHE_LINE) int back; // the writer's slot
+    _Alignas(CACHE_LINE) int front; // the reader's slot
+} FrameBuffer;
+
+void initializeFrameBuffer(FrameBuffer* buffer);
+void publishFrame(FrameBuffer* buffer, const unsigned long long* screen, unsigned long long tag);
+const unsigned long long* takeFrame(FrameBuffer* buffer, unsigned long long* tag);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define DEFAULT_INSTANCES 1
+#define DEFAULT_CYCLES 1000000
+#define MAX_THREADS 256
+
+typedef struct {
+    CHIP8* instances; // every instance in the batch (shared by all workers)
+    int numInstances;
+    unsigned long cycles; // cycle budget per instance
+    unsigned int instructionsPerFrame; // the timers tick once every this many instructions
+    EngineType engineType; // each worker runs its instances with its own engine of this type
+    const char** romPaths; // instance i runs romPaths[i % numROMs] (the aot engine loads its module from there)
+    int numROMs;
+    int lockstep; // run BATCH_LANES instances at a time through the lockstep engine instead
+    int skipIdle; // skip the rest of a frame spent in an idle loop (see idle.h)
+    Tracer* tracer; // NULL unless tracing: worker i traces into ring i (see trace.h)
+    QuirkProfile quirks; // which variant of CHIP-8 the interpreter behaves as (see quirks.h)
+    atomic_int nextInstance; // workers grab instances from here until they run out
+} Batch;
+
+typedef struct {
+    Batch* batch;
+    int index;
+    pthread_t thread;
+    int instancesRun;
+    unsigned long long instructions; // total instructions this worker executed
+    unsigned long long vectorSteps; // lockstep only: vector instructions run, each for one or more lanes
+    unsigned long long vectorInstructions; // and how many lane-instructions that came to
+    unsigned long long skipped; // instructions skipped in idle loops (counted in instructions too)
+} Worker;
+
+void* runWorker(void* arg);
+void runEngineWorker(Worker* worker);
+void runLockstepWorker(Worker* worker);
+int parseCount(const char* arg, unsigned long* out);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <SDL2/SDL.h>
+
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+#define HUD_SCALE 2 // window pixels per font pixel
+#define HUD_MARGIN 8
+#define HUD_LINE_LENGTH 64
+#define HUD_REFRESH_MS 250 // how often the overlay is redrawn while the screen itself does not change
+
+void drawHud(SDL_Renderer* renderer, const Telemetry* telemetry);
+void drawText(SDL_Renderer* renderer, int x, int y, const char* text);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#define MAX_IDLE_LOOP 16 // longest loop (in instructions) that is recognized as idle
+#define MAX_IDLE_BACKOFF 32 // frames between probes after repeated misses, so busy ROMs barely pay for the check
+
+/*
+    - many ROMs spin while they wait for the delay timer (Fx07, 3xkk, 1nnn) or for a key (ExA1, 1nnn). Within a frame
+      neither the timers nor the keys can change, so once such a loop brings the machine back to exactly the same
+      state it will keep doing so until the frame ends, and the rest of the frame can be skipped
+    - the loop is found by running it: up to two passes through emulateCycle, and only instructions that touch nothing
+      but V, I and pc (no draws, stack, memory writes, timer writes or Cxkk). The result is identical to running every
+      instruction, so recordings and golden hashes are unaffected
+*/
+
+typedef struct {
+    int enabled;
+    int wait; // frames until the next probe
+    int backoff; // wait after the next miss
+    int detected; // the last frame ended in an idle loop
+    int waitingForInput; // the last loop found had both timers at zero, so it stays there until a key changes
+    unsigned char keyboard[KEYBOARD_SIZE]; // the keys it was found with
+    unsigned long long skipped; // instructions not run because of it
+} IdleDetector;
+
+void resetIdleDetector(IdleDetector* idle);
+unsigned long skipIdleLoop(IdleDetector* idle, CHIP8* chip8, unsigned long cycles);
+
+#endif
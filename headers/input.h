@@ -0,0 +1,33 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL2/SDL.h>
+
+#define NO_KEY 0xFF // scancode that is not a CHIP-8 key
+#define MAX_KEYMAP_LINE 256
+
+/*
+    - which physical key is which CHIP-8 key is a lookup table indexed by SDL scancode, so the layout follows key
+      positions (the default is the usual 1234 / QWER / ASDF / ZXCV block whatever the keyboard layout)
+    - a keymap file replaces it: one "<CHIP-8 key in hex> <SDL scancode name>" per line, # starts a comment.
+      A CHIP-8 key can be on several physical keys
+*/
+
+typedef struct {
+    unsigned char keys[SDL_NUM_SCANCODES]; // CHIP-8 key for each scancode, NO_KEY if none
+} Keymap;
+
+// time from an input to some later point, for showing the input lag
+typedef struct {
+    unsigned long long count;
+    unsigned long long total; // ns
+    unsigned long long max;
+} LatencyStats;
+
+void defaultKeymap(Keymap* keymap);
+int loadKeymap(Keymap* keymap, const char* filename);
+void initializeLatency(LatencyStats* stats);
+void recordLatency(LatencyStats* stats, unsigned long long nanoseconds);
+void printLatency(const char* name, const LatencyStats* stats);
+
+#endif
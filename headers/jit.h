@@ -0,0 +1,39 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stddef.h>
+
+#define JIT_CODE_SIZE (1024 * 1024) // when the code buffer fills up, every block is thrown away and compiled again
+#define JIT_MAX_BLOCK_LENGTH 64 // instructions
+#define JIT_CACHED_REGISTERS 4 // most-used V registers of a block that live in host registers (r8b - r11b)
+
+// a compiled block runs at most budget instructions and returns how many of the budget are left,
+// with pc, I and V written back to chip8
+typedef int (*JitBlockFn)(CHIP8* chip8, int budget);
+
+enum {
+    JIT_BLOCK_EMPTY = 0, // not looked at yet
+    JIT_BLOCK_COMPILED,
+    JIT_BLOCK_INTERPRET // starts with an instruction the JIT leaves to emulateCycle (Dxyn, keys, Cxkk, Fx33, Fx55, ...)
+};
+
+typedef struct {
+    JitBlockFn code;
+    unsigned char status;
+} JitBlock;
+
+typedef struct {
+    JitBlock blocks[MEMORY_SIZE]; // keyed by start address
+    unsigned char covered[MEMORY_SIZE]; // set for every byte some block (or INTERPRET entry) was built from
+    unsigned char* code; // executable buffer the blocks are emitted into
+    size_t codeUsed;
+} JitCache;
+
+int jitSupported();
+JitCache* createJitCache();
+void destroyJitCache(JitCache* jit);
+void clearJitCache(JitCache* jit);
+void invalidateJitCache(JitCache* jit, unsigned short address, unsigned short length);
+void runJit(CHIP8* chip8, JitCache* jit, unsigned long cycles);
+
+#endif
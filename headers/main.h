@@ -1,9 +1,44 @@
 #include <SDL2/SDL.h>
-#include <unistd.h>
+#include <stdatomic.h>
+#include <string.h>
 
 #define WINDOW_SCALE 16
 #define WINDOW_WIDTH (SCREEN_WIDTH * WINDOW_SCALE)
 #define WINDOW_HEIGHT (SCREEN_HEIGHT * WINDOW_SCALE)
+#define IDLE_WAIT_MS 250 // longest sleep while the ROM waits for a key, in case no event ever comes
+
+// emulator controls that are not CHIP-8 keys
+typedef struct {
+    int rewinding; // backspace is held
+    int saveRequested; // F5
+    int loadRequested; // F7
+    int hudToggled; // F1
+    int redraw; // the window was exposed, restored or resized, and has to be drawn again
+} Controls;
+
+// shared between the UI thread and the emulation thread (runCore). The emulation thread owns everything up to
+// statePath; the atomics are written by the UI thread, which posts wake whenever it changes one
+typedef struct {
+    CHIP8* chip8;
+    Engine* engine;
+    Scheduler* scheduler;
+    RewindBuffer* rewind;
+    Recorder* recorder; // NULL unless recording
+    const char* statePath;
+    Beeper* beeper; // told about every frame, its callback does the rest
+    FrameBuffer frames; // screens going to the UI thread
+    atomic_int framePending; // an SDL_USEREVENT announcing a frame has been pushed and not handled yet
+    atomic_ushort keys; // CHIP-8 keys held, one bit per key (see keyboardMask)
+    atomic_ullong inputTime; // monotonic ns of the last change to keys
+    unsigned long long lastInput; // inputTime of the newest keys the emulation has used, passed along with each frame
+    LatencyStats pickupLatency; // from a key changing to the first frame that runs with it
+    Telemetry* telemetry; // emulation time, instructions and sleep overshoot of every frame
+    atomic_int rewinding;
+    atomic_int saveRequested;
+    atomic_int loadRequested;
+    atomic_int quit;
+    SDL_sem* wake;
+} Core;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
@@ -11,4 +46,6 @@ SDL_Texture* texture = NULL;
 
 int initialize();
 void closeDisplay();
-int handleInput(unsigned char* keyboard);
\ No newline at end of file
+int handleInput(const Keymap* keymap, unsigned char* keyboard, Controls* controls);
+int runCore(void* data);
+void notifyFrame(Core* core);
\ No newline at end of file
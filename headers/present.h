@@ -0,0 +1,25 @@
+#ifndef PRESENT_H
+#define PRESENT_H
+
+#include <SDL2/SDL.h>
+
+#define DEFAULT_REFRESH_RATE 60
+
+typedef struct {
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    unsigned long long shown[SCREEN_HEIGHT]; // the rows that are in the texture right now
+    unsigned long long refreshNanoseconds; // one refresh of the display the window is on
+    unsigned long long lastPresent;
+    int forceRedraw; // present even if nothing changed (first frame, window exposed, ...)
+    Telemetry* telemetry; // upload and present times go here
+    int showHud; // draw the telemetry over the screen (see hud.h)
+} Presenter;
+
+void initializePresenter(Presenter* presenter, SDL_Window* window, SDL_Renderer* renderer, SDL_Texture* texture, Telemetry* telemetry);
+unsigned long long refreshNanoseconds(SDL_Window* window);
+int presentFrame(Presenter* presenter, const unsigned long long* screen);
+int uploadChangedRows(SDL_Texture* texture, int x, int y, const unsigned long long* screen, unsigned long long* shown);
+unsigned int millisecondsUntilRefresh(const Presenter* presenter);
+
+#endif
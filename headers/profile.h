@@ -0,0 +1,53 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/*
+    - build with -DCHIP8_PROFILE (e.g. make profile) to count every instruction emulateCycle runs
+    - without it, PROFILE_INSTRUCTION and PROFILE_FLUSH expand to nothing, so a normal build is untouched
+    - the hot path is one compare and one increment: each address keeps a running count for the opcode and stack
+      depth it last ran with, and only when either changes is that count moved into the per-class, per-address
+      and per-depth totals (self-modifying code and subroutines called from different depths still count exactly)
+    - counters are per thread (no atomics on the hot path) and are added into one total when a thread
+      calls PROFILE_FLUSH, then the report is printed to stderr when the program exits
+    - only emulateCycle is instrumented, so profile with the interpreter engine (the others only pass it their fallbacks)
+*/
+#ifdef CHIP8_PROFILE
+
+#define PROFILE_TOP_PCS 20 // rows in the hot-spot table
+#define PROFILE_MAX_DEPTH 256 // sp is a byte, so every value it can take gets a bucket
+
+typedef struct {
+    unsigned long long count; // runs since tag last changed
+    unsigned int tag; // opcode | sp << 16
+} ProfileSlot;
+
+typedef struct {
+    ProfileSlot slots[MEMORY_SIZE]; // keyed by pc
+    unsigned long long opcodes[MEMORY_SIZE]; // keyed by first nibble and low byte, which is all any class depends on
+    unsigned long long pcs[MEMORY_SIZE];
+    unsigned long long depths[PROFILE_MAX_DEPTH];
+} ProfileCounters;
+
+extern _Thread_local ProfileCounters profileCounters;
+
+void retagProfileSlot(ProfileSlot* slot, unsigned int tag);
+void flushProfile();
+
+#define PROFILE_INSTRUCTION(chip8, opcode) \
+    do { \
+        ProfileSlot* slot = &profileCounters.slots[(chip8)->pc & (MEMORY_SIZE - 1)]; \
+        unsigned int tag = (opcode) | ((unsigned int)(chip8)->sp << 16); \
+        if (__builtin_expect(slot->tag != tag, 0)) \
+            retagProfileSlot(slot, tag); \
+        slot->count++; \
+    } while (0)
+#define PROFILE_FLUSH() flushProfile()
+
+#else
+
+#define PROFILE_INSTRUCTION(chip8, opcode) do { } while (0)
+#define PROFILE_FLUSH() do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include "trace.h"
+
+/*
+    - the CHIP-8 variants disagree on a handful of instructions, and ROMs written for one misbehave on another.
+      Each difference is a quirk bit; a profile is the set of quirks of one variant
+    - there is one copy of the interpreter loop per profile, built at compile time with the profile's quirks as
+      constants (see chip8.c), and the one to use is picked once when the engine is set up. So the running loop
+      has no branches on quirk flags at all
+    - the other engines only implement the default profile, which is how this emulator has always behaved
+*/
+
+#define QUIRK_SHIFT_VY 1 // 8xy6/8xyE shift Vy into Vx, instead of shifting Vx in place
+#define QUIRK_INCREMENT_I 2 // Fx55/Fx65 leave I just past the last register (I += x + 1)
+#define QUIRK_INCREMENT_I_BY_X 4 // Fx55/Fx65 leave I on the last register (I += x)
+#define QUIRK_JUMP_VX 8 // Bxnn jumps to xnn + Vx, instead of Bnnn to nnn + V0
+#define QUIRK_WRAP_SPRITES 16 // Dxyn wraps sprites around the edges of the screen, instead of clipping them
+
+#define DEFAULT_QUIRKS 0
+#define VIP_QUIRKS (QUIRK_SHIFT_VY | QUIRK_INCREMENT_I)
+#define CHIP48_QUIRKS (QUIRK_INCREMENT_I_BY_X | QUIRK_JUMP_VX)
+#define SCHIP_QUIRKS QUIRK_JUMP_VX
+#define XOCHIP_QUIRKS (QUIRK_SHIFT_VY | QUIRK_INCREMENT_I | QUIRK_WRAP_SPRITES)
+
+typedef enum {
+    QUIRKS_DEFAULT,
+    QUIRKS_VIP, // COSMAC VIP, the original interpreter
+    QUIRKS_CHIP48, // CHIP-48 on the HP 48
+    QUIRKS_SCHIP, // SUPER-CHIP 1.1 (its CHIP-8 instructions only)
+    QUIRKS_XOCHIP, // XO-CHIP as Octo runs it, the only one that wraps sprites (its CHIP-8 instructions only)
+    NUM_QUIRK_PROFILES
+} QuirkProfile;
+
+// the interpreter specialized for one profile
+typedef struct {
+    const char* name;
+    unsigned int quirks;
+    void (*run)(CHIP8* chip8, unsigned long cycles);
+    void (*trace)(CHIP8* chip8, TraceRing* trace, unsigned long cycles); // run, with a record of every instruction
+} Interpreter;
+
+const Interpreter* selectInterpreter(QuirkProfile profile);
+int parseQuirkProfile(const char* name, QuirkProfile* profile);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef RECOMPILE_H
+#define RECOMPILE_H
+
+#include <string.h>
+
+// what the analysis found at each address
+enum {
+    SITE_UNREACHED = 0,
+    SITE_COMPILED, // reached, and the module runs it
+    SITE_EXIT // reached, but left to emulateCycle (Fx33, Fx55, 0nnn, unknown opcodes)
+};
+
+typedef struct {
+    unsigned char sites[MEMORY_SIZE];
+    int romSize;
+    int numCompiled;
+    int numExits;
+    int numIndirect; // Bnnn and 00EE, whose targets are only known at runtime
+} Analysis;
+
+void analyze(const unsigned char* memory, int romSize, Analysis* analysis);
+int isExit(unsigned short opcode);
+void emitModule(FILE* out, const char* romPath, const unsigned char* memory, const Analysis* analysis);
+void emitInstruction(FILE* out, const unsigned char* memory, const Analysis* analysis, unsigned short address, int nextEmitted);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#define RECORDING_MAGIC "C8IN"
+#define RECORDING_VERSION 1
+#define RECORDING_HEADER_SIZE 14 // magic + 16-bit version + 32-bit seed + 32-bit instructions per frame
+#define MAX_RUN_LENGTH 0xFFFF // frames in one run, so the count fits in 16 bits
+
+/*
+    - a recording is everything that makes a session differ from another run of the same ROM: the seed behind Cxkk,
+      the instructions per frame, and which keys were held during each frame
+    - frames are stored as runs of [16-bit key mask][16-bit frame count] (little endian, like save states),
+      so a minute of play where the keys rarely change is a few hundred bytes
+*/
+
+typedef struct {
+    FILE* file;
+    unsigned short keys; // mask of the run being built
+    unsigned int run; // frames in it so far
+} Recorder;
+
+typedef struct {
+    unsigned int seed;
+    unsigned int instructionsPerFrame;
+    unsigned short* frames; // one key mask per frame
+    unsigned long numFrames;
+} Recording;
+
+unsigned short keyboardMask(const unsigned char* keyboard);
+void applyKeyboardMask(unsigned char* keyboard, unsigned short mask);
+unsigned long long hashScreen(const unsigned long long* screen);
+int startRecording(Recorder* recorder, const char* filename, unsigned int seed, unsigned int instructionsPerFrame);
+void recordFrame(Recorder* recorder, const unsigned char* keyboard);
+int stopRecording(Recorder* recorder);
+int loadRecording(Recording* recording, const char* filename);
+void freeRecording(Recording* recording);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <string.h>
+
+void replayRecording(Engine* engine, CHIP8* chip8, const Recording* recording, unsigned long long* hashes);
+int writeGolden(const char* filename, const unsigned long long* hashes, unsigned long numFrames);
+int checkGolden(const char* filename, const unsigned long long* hashes, unsigned long numFrames);
+
+#endif
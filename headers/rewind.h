@@ -0,0 +1,32 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "savestate.h"
+
+#define DEFAULT_REWIND_SECONDS 10
+#define KEYFRAME_INTERVAL 60 // one full state per second of frames, everything in between is a delta against it
+#define RETIRED_KEYFRAME -1 // the keyframe of a delta whose keyframe has been dropped (kept in RewindBuffer.retired)
+
+typedef struct {
+    unsigned char* data; // a serialized state for keyframes, an encoded delta otherwise
+    int length;
+    int capacity;
+    int keyframe; // index of the entry this one is a delta against (its own index for a keyframe, or RETIRED_KEYFRAME)
+} RewindEntry;
+
+// ring buffer of the last capacity frames, oldest at start
+typedef struct {
+    RewindEntry* entries;
+    int capacity;
+    int start;
+    int count;
+    unsigned char state[STATE_SIZE]; // scratch space for serializing/decoding
+    unsigned char retired[STATE_SIZE]; // the last keyframe dropped, while deltas against it are still in the ring
+} RewindBuffer;
+
+int createRewindBuffer(RewindBuffer* rewind, int frames);
+void destroyRewindBuffer(RewindBuffer* rewind);
+int captureFrame(RewindBuffer* rewind, const CHIP8* chip8);
+int rewindFrame(RewindBuffer* rewind, CHIP8* chip8);
+
+#endif
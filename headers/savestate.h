@@ -0,0 +1,15 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#define STATE_MAGIC "C8ST"
+#define STATE_VERSION 2
+#define STATE_HEADER_SIZE 6 // magic + 16-bit version
+// memory, V, I, soundTimer, delayTimer, pc, sp, stack, keyboard, screen, rngState
+#define STATE_SIZE (STATE_HEADER_SIZE + MEMORY_SIZE + NUM_REGISTERS + 2 + 1 + 1 + 2 + 1 + STACK_SIZE * 2 + KEYBOARD_SIZE + SCREEN_HEIGHT * 8 + 4)
+
+int serializeState(const CHIP8* chip8, unsigned char* out);
+int deserializeState(CHIP8* chip8, const unsigned char* in);
+int saveState(const CHIP8* chip8, const char* filename);
+int loadState(CHIP8* chip8, const char* filename);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <time.h>
+
+#include "engine.h"
+
+#define TIMER_HZ 60 // the delay and sound timers always count down at 60Hz, so a frame is 1/60th of a second
+#define NANOSECONDS_PER_SECOND 1000000000ULL
+#define NANOSECONDS_PER_MILLISECOND 1000000ULL
+#define DEFAULT_INSTRUCTIONS_PER_FRAME 10 // ~600 instructions per second, about what the old usleep(1500) pacing gave
+#define MAX_CATCHUP_FRAMES 4 // if the host stalls, drop the backlog instead of running a burst of frames to catch up
+
+typedef struct {
+    unsigned int instructionsPerFrame;
+    int turbo; // when set, frames run back to back instead of being paced to the wall clock
+    unsigned long long lastTime; // monotonic time (ns) of the last call to framesDue
+    unsigned long long accumulator; // elapsed time not yet turned into frames, in ns * TIMER_HZ (so a frame is exactly 1e9 units)
+} Scheduler;
+
+unsigned long long monotonicNanoseconds();
+void initializeScheduler(Scheduler* scheduler, unsigned int instructionsPerFrame, int turbo);
+int framesDue(Scheduler* scheduler);
+unsigned long long nanosecondsUntilNextFrame(Scheduler* scheduler);
+unsigned int millisecondsUntilNextFrame(Scheduler* scheduler);
+void runFrame(Engine* engine, CHIP8* chip8, unsigned int instructionsPerFrame);
+void runCycles(Engine* engine, CHIP8* chip8, unsigned long cycles, unsigned int instructionsPerFrame);
+
+#endif
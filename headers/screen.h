@@ -0,0 +1,10 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#define PIXEL_ON 0xFFFFFFFF // RGBA8888
+#define PIXEL_OFF 0x00000000
+
+void expandScreen(const unsigned long long* screen, unsigned int* pixels);
+void expandRows(const unsigned long long* screen, unsigned int* pixels, int pitch, int firstRow, int numRows);
+
+#endif
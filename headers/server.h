@@ -0,0 +1,54 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <poll.h>
+
+#define MAX_INSTANCES 256 // instance numbers go in one byte of the message header
+#define MAX_CLIENTS 64
+#define LISTEN_BACKLOG 8
+
+typedef struct {
+    CHIP8 chip8;
+    Engine engine;
+    unsigned short keys; // held keys: those of every client playing it put together
+    unsigned long long previous[SCREEN_HEIGHT]; // the screen as of the last frame sent
+    unsigned int frame;
+    unsigned char message[MAX_MESSAGE_SIZE]; // FRAME message from previous to the current screen, built once for every subscriber
+    int messageLength; // 0 when the last frame changed nothing
+} Instance;
+
+typedef struct {
+    int fd; // -1 for a free slot
+    int instance; // -1 until the client subscribes
+    int keysInstance; // the instance its last KEYS message was for, -1 before it sent one
+    unsigned short keys; // the keys that message held
+    int synced; // the client's screen is the instance's previous one, so the shared message brings it up to date
+    unsigned long long base[SCREEN_HEIGHT]; // otherwise: the screen it will have once everything already sent arrives
+    unsigned char pending[MAX_MESSAGE_SIZE]; // the rest of a message the socket had no room for
+    int pendingStart;
+    int pendingLength;
+    MessageReader reader;
+    unsigned long long bytesSent;
+} Client;
+
+typedef struct {
+    Instance* instances;
+    int numInstances;
+    unsigned int instructionsPerFrame;
+    Client clients[MAX_CLIENTS];
+    int listener;
+    unsigned long long frames;
+    unsigned long long bytesSent; // by clients that have disconnected
+} Server;
+
+int openListener(const char* path);
+void acceptClient(Server* server);
+void closeClient(Server* server, Client* client);
+void readClient(Server* server, Client* client);
+void updateKeys(Server* server, int instance);
+void runServerFrame(Server* server);
+int sendFrame(Instance* instance, Client* client);
+int sendToClient(Client* client, const unsigned char* data, int length);
+int flushClient(Client* client);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SNAPCHECK_H
+#define SNAPCHECK_H
+
+#include <string.h>
+
+#define SNAPCHECK_STEPS 600 // steps tried before giving up on a ROM that never writes to memory
+#define SNAPCHECK_FRAMES 10 // frames per step
+
+int checkOutOfMemory(const CHIP8* root, EngineType type);
+int sameSnapshot(const Snapshot* a, const Snapshot* b);
+int holdsSnapshot(const Searcher* searcher, const Snapshot* snapshot);
+
+#endif
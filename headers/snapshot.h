@@ -0,0 +1,60 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+
+#define PAGE_SIZE 256
+#define NUM_PAGES (MEMORY_SIZE / PAGE_SIZE)
+#define PAGES_PER_BLOCK 1024 // the pool grows this many pages at a time
+#define MACHINE_STATE_OFFSET offsetof(CHIP8, V) // everything in CHIP8 after memory: registers, stack, keys, screen, ...
+#define MACHINE_STATE_SIZE (sizeof(CHIP8) - MACHINE_STATE_OFFSET)
+
+/*
+    - cheap copies of a machine for tree search: a snapshot is the ~330 bytes of CHIP8 that are not memory, plus one
+      pointer per 256-byte page of memory. Pages are reference counted and shared, so cloning copies the small part
+      and bumps 16 counts, and a snapshot only owns the pages its own steps wrote to (most ROMs never write to memory
+      outside a few bytes of scratch, so a search tree mostly shares one copy of the ROM)
+    - steps run on a single working machine (Searcher.chip8). Restoring a snapshot into it only copies the pages it
+      does not already hold, and only those are invalidated in the engine's cache, so predecoded and translated code
+      survives jumping around the tree
+    - pages come from a pool that hands out fixed-size blocks and keeps freed pages on a list, so neither cloning
+      nor releasing calls malloc. A search can cap the pages it uses with PagePool.maxPages; going over it fails
+      the same way running out of memory does
+*/
+
+typedef struct Page {
+    unsigned char data[PAGE_SIZE];
+    unsigned int references; // snapshots holding it (plus the searcher, while its working memory matches it)
+    struct Page* next; // next free page, while on the free list
+} Page;
+
+typedef struct {
+    Page* free;
+    Page** blocks; // every block allocated, freed with the pool
+    int numBlocks;
+    unsigned long pagesInUse;
+    unsigned long maxPages; // 0 for no limit
+} PagePool;
+
+typedef struct {
+    unsigned char state[MACHINE_STATE_SIZE]; // copied as is from the CHIP8
+    Page* pages[NUM_PAGES];
+} Snapshot;
+
+typedef struct {
+    CHIP8 chip8; // the working machine: only run it through stepSnapshot, or capture it after running it yourself
+    Engine engine;
+    unsigned int instructionsPerFrame;
+    PagePool pool;
+    Page* loaded[NUM_PAGES]; // the page each part of chip8.memory holds (the searcher keeps a reference to each), NULL if none does
+} Searcher;
+
+int createSearcher(Searcher* searcher, const CHIP8* root, EngineType type, unsigned int instructionsPerFrame);
+void destroySearcher(Searcher* searcher);
+int captureSnapshot(Searcher* searcher, Snapshot* snapshot);
+void restoreSnapshot(Searcher* searcher, const Snapshot* snapshot);
+void cloneSnapshot(Snapshot* clone, const Snapshot* snapshot);
+int stepSnapshot(Searcher* searcher, Snapshot* snapshot, unsigned short keys, unsigned int frames);
+void releaseSnapshot(Searcher* searcher, Snapshot* snapshot);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "delta.h"
+
+#define DEFAULT_SOCKET_PATH "chip8.sock"
+#define SCREEN_BYTES (SCREEN_HEIGHT * 8)
+#define MESSAGE_HEADER_SIZE 4 // type, instance, 16-bit payload length (little endian)
+#define FRAME_HEADER_SIZE 4 // 32-bit frame number in front of the delta
+#define MAX_PAYLOAD_SIZE (FRAME_HEADER_SIZE + DELTA_MAX_SIZE(SCREEN_BYTES))
+#define MAX_MESSAGE_SIZE (MESSAGE_HEADER_SIZE + MAX_PAYLOAD_SIZE)
+
+/*
+    - the protocol between ./server and its clients over a Unix domain socket: every message is a 4-byte header and a payload
+    - the server sends INFO once on connect, then a FRAME whenever the screen of the instance the client subscribed
+      to changes: the delta (see delta.c) between the screen the client already has and the new one. A client that
+      subscribes starts from a blank screen. Nothing at all is sent while the screen stays the same
+    - clients send SUBSCRIBE to pick an instance and KEYS with the mask of held keys (see keyboardMask) to play it.
+      Both ends are on the same host, so screen rows go in host byte order
+*/
+
+enum {
+    MESSAGE_INFO = 1, // server -> client, payload: 16-bit number of instances, 16-bit instructions per frame
+    MESSAGE_SUBSCRIBE, // client -> server, no payload
+    MESSAGE_KEYS, // client -> server, payload: 16-bit key mask
+    MESSAGE_FRAME // server -> client, payload: 32-bit frame number, then the delta
+};
+
+typedef struct {
+    unsigned char type;
+    unsigned char instance;
+    int length;
+    const unsigned char* payload; // points into the reader's buffer, valid until the next receiveMessages
+} Message;
+
+// collects whatever arrives on a socket until it makes whole messages
+typedef struct {
+    unsigned char buffer[2 * MAX_MESSAGE_SIZE];
+    int start; // first byte not consumed by nextMessage
+    int length;
+} MessageReader;
+
+void packHeader(unsigned char* out, unsigned char type, unsigned char instance, int length);
+void put16(unsigned char* out, unsigned int value);
+void put32(unsigned char* out, unsigned int value);
+unsigned int get16(const unsigned char* in);
+unsigned int get32(const unsigned char* in);
+int sendMessage(int fd, unsigned char type, unsigned char instance, const unsigned char* payload, int length);
+void initializeReader(MessageReader* reader);
+int receiveMessages(MessageReader* reader, int fd);
+int nextMessage(MessageReader* reader, Message* message);
+
+#endif
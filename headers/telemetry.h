@@ -0,0 +1,48 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdatomic.h>
+
+#define HISTOGRAM_SUB_BITS 3 // 8 bins per power of two, so a percentile is within 12.5% of the real value
+#define HISTOGRAM_SUB_BINS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BINS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BINS) // enough for any 64-bit value
+
+/*
+    - per-frame timings, to see where a stuttering frame went: each metric is a fixed-size log-scale histogram,
+      so recording a value is a couple of stores and the figures cover the whole session in 4 KB apiece
+    - every histogram has a single writer (the emulation thread or the UI thread) and the bins are atomics, so the
+      HUD can read the other thread's figures while they are being recorded
+*/
+
+enum {
+    METRIC_EMULATION, // emulation thread: time to run one frame's instructions and timer tick (ns)
+    METRIC_INSTRUCTIONS, // emulation thread: instructions actually executed in a frame (idle loops skipped are not)
+    METRIC_OVERSHOOT, // emulation thread: how late a sleep until the next frame woke up (ns)
+    METRIC_UPLOAD, // UI thread: expanding changed rows into the texture (ns)
+    METRIC_PRESENT, // UI thread: copying the texture to the window and presenting (ns)
+    NUM_METRICS
+};
+
+typedef struct {
+    atomic_ullong bins[HISTOGRAM_BINS];
+    atomic_ullong count;
+    atomic_ullong total;
+    atomic_ullong max;
+} Histogram;
+
+typedef struct {
+    Histogram histograms[NUM_METRICS];
+} Telemetry;
+
+void initializeTelemetry(Telemetry* telemetry);
+void recordMetric(Telemetry* telemetry, int metric, unsigned long long value);
+unsigned long long metricPercentile(const Telemetry* telemetry, int metric, double fraction);
+unsigned long long metricCount(const Telemetry* telemetry, int metric);
+unsigned long long metricMax(const Telemetry* telemetry, int metric);
+const char* metricName(int metric);
+const char* metricUnit(int metric);
+void formatMetric(char* out, int size, int metric, unsigned long long value);
+int writeTelemetry(const Telemetry* telemetry, const char* filename);
+void printTelemetry(const Telemetry* telemetry);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 8 // magic + 16-bit version + 16-bit record size
+#define TRACE_CHUNK_HEADER_SIZE 16 // 32-bit instance + 32-bit record count + 64-bit records dropped since the ring's last chunk
+#define TRACE_RING_RECORDS (1 << 18) // per ring, a power of two (2 MB: a few ms of a headless run, minutes of ./main)
+#define TRACE_FLUSH_US 1000 // how long the flush thread sleeps between passes over the rings
+#define TRACE_FILE_BUFFER (1 << 20)
+#define MAX_TRACE_RINGS 256
+
+/*
+    - an execution trace: one fixed-size record per instruction the interpreter runs (its trace loop is emulateCycle
+      with the record written at the end, see quirks.h), put in a single-producer single-consumer ring that belongs
+      to the running instance
+    - the core never waits on the ring: records that do not fit are dropped and counted instead. A background thread
+      (the flush thread) copies whatever the rings hold into the trace file, and is the only one that waits.
+      The two share as few cache lines as possible: the core hands records over once per runInstructions, and only
+      reads how far the flush thread got when the ring looks full
+    - the file is TRACE_MAGIC, the version and the record size, then chunks of [instance][count][dropped] (little
+      endian, like recordings) each followed by count records. Records are written as they sit in the ring, which
+      is little endian on every platform this builds for. ./tracedump disassembles and filters them
+*/
+
+typedef struct {
+    unsigned short pc;
+    unsigned short opcode;
+    unsigned short I; // after the instruction ran
+    unsigned char Vx; // x of the opcode, after it ran (whether the instruction wrote it is up to the opcode)
+    unsigned char VF; // after it ran
+} TraceRecord;
+
+typedef struct {
+    TraceRecord records[TRACE_RING_RECORDS];
+    atomic_uint instance; // what the flush thread labels the records with (only changed while the ring is empty)
+    _Alignas(64) unsigned long long head; // the core's copy of written (only the core touches it)
+    unsigned long long tailSeen; // the last value of read the core looked at
+    unsigned long long droppedCount; // the core's copy of dropped
+    _Alignas(64) atomic_ullong written; // records put in the ring and handed to the flush thread, ever
+    atomic_ullong dropped; // records that did not fit
+    _Alignas(64) atomic_ullong read; // records the flush thread has taken out, ever
+} TraceRing;
+
+// the header of one chunk of a trace file
+typedef struct {
+    unsigned int instance;
+    unsigned int count; // records that follow (at most TRACE_RING_RECORDS)
+    unsigned long long dropped; // records of the same ring that were lost after the ones in this chunk
+} TraceChunk;
+
+typedef struct {
+    FILE* file;
+    TraceRing* rings[MAX_TRACE_RINGS];
+    int numRings;
+    unsigned long long droppedWritten[MAX_TRACE_RINGS]; // dropped of each ring as of its last chunk
+    pthread_t thread;
+    atomic_int quit;
+} Tracer;
+
+int openTracer(Tracer* tracer, const char* filename, int numRings);
+int closeTracer(Tracer* tracer);
+unsigned long reserveTrace(TraceRing* ring, unsigned long records);
+void publishTrace(TraceRing* ring, unsigned long records);
+void setTraceInstance(TraceRing* ring, unsigned int instance);
+void* runTraceFlush(void* arg);
+int flushTraceRing(Tracer* tracer, int index);
+int readTraceHeader(FILE* file);
+int readTraceChunk(FILE* file, TraceChunk* chunk, TraceRecord* records);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef TRACEDUMP_H
+#define TRACEDUMP_H
+
+#include <string.h>
+
+#define ALL_INSTANCES -1
+
+// which records get printed
+typedef struct {
+    long instance; // ALL_INSTANCES or just this one
+    unsigned short firstPC; // inclusive range
+    unsigned short lastPC;
+    unsigned short opcode; // records whose opcode & opcodeMask equals opcode
+    unsigned short opcodeMask;
+} TraceFilter;
+
+int parseFilter(TraceFilter* filter, const char* option, const char* value);
+int matchesFilter(const TraceFilter* filter, unsigned int instance, const TraceRecord* record);
+int writesVx(unsigned short opcode);
+int writesVF(unsigned short opcode);
+void printRecord(unsigned int instance, const TraceRecord* record);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <SDL2/SDL.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#define MAX_WALL_INSTANCES 256
+#define TILE_GAP 1 // atlas pixels between tiles
+#define TILE_WIDTH (SCREEN_WIDTH + TILE_GAP)
+#define TILE_HEIGHT (SCREEN_HEIGHT + TILE_GAP)
+#define GAP_COLOR 0x404040FF // RGBA8888, like PIXEL_ON
+#define MAX_WINDOW_WIDTH 1600 // the window is the atlas scaled up by as much as fits in this
+#define MAX_WINDOW_HEIGHT 900
+#define IDLE_WAIT_MS 250 // longest sleep while no instance draws anything
+
+typedef struct {
+    CHIP8 chip8;
+    Engine engine;
+    FrameBuffer frames; // its screens going to the UI thread
+} WallInstance;
+
+// shared between the UI thread and the emulation thread (runWall)
+typedef struct {
+    WallInstance* instances;
+    int numInstances;
+    Scheduler* scheduler;
+    Telemetry* telemetry;
+    atomic_int framePending; // an SDL_USEREVENT announcing new frames has been pushed and not handled yet
+    atomic_int quit;
+} WallCore;
+
+// every instance's screen is a tile of one streaming texture, which is copied to the window in one go
+typedef struct {
+    SDL_Renderer* renderer;
+    SDL_Texture* atlas;
+    int columns;
+    int rows;
+    unsigned long long (*shown)[SCREEN_HEIGHT]; // the rows of each tile that are in the atlas right now
+    const unsigned long long** latest; // the newest frame of each instance not uploaded yet, or NULL
+    unsigned long long refreshNanoseconds;
+    unsigned long long lastPresent;
+    int forceRedraw; // present even if no tile changed (first frame, window exposed, ...)
+    Telemetry* telemetry;
+} Wall;
+
+int runWall(void* data);
+int createWall(Wall* wall, SDL_Window* window, SDL_Renderer* renderer, int numInstances, int columns, Telemetry* telemetry);
+void destroyWall(Wall* wall);
+int presentWall(Wall* wall, int numInstances);
+unsigned int millisecondsUntilWallRefresh(const Wall* wall);
+
+#endif
@@ -0,0 +1,275 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/batch.h"
+#include "headers/headless.h"
+#include "headers/profile.h"
+
+#include <string.h>
+#include <time.h>
+
+int main(int argc, char *argv[]) {
+    unsigned long numInstances = DEFAULT_INSTANCES;
+    unsigned long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long cycles = DEFAULT_CYCLES;
+    unsigned long frames = 0;
+    unsigned long instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    EngineType engineType = ENGINE_INTERPRETER;
+    unsigned long seed = DEFAULT_SEED;
+    int lockstep = 0;
+    int skipIdle = 0;
+    const char* tracePath = NULL;
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+
+    // parse the options, everything after them is a ROM path
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        unsigned long value;
+        if (strcmp(argv[arg], "-e") == 0 && arg + 1 < argc) {
+            if (!parseEngineType(argv[arg+1], &engineType)) {
+                fprintf(stderr, "Unknown engine %s\n", argv[arg+1]);
+                exit(1);
+            }
+            arg += 2;
+            continue;
+        }
+        if (strcmp(argv[arg], "-l") == 0) {
+            lockstep = 1;
+            arg++;
+            continue;
+        }
+        if (strcmp(argv[arg], "-q") == 0 && arg + 1 < argc) {
+            if (!parseQuirkProfile(argv[arg+1], &quirks)) {
+                fprintf(stderr, "Unknown quirk profile %s\n", argv[arg+1]);
+                exit(1);
+            }
+            arg += 2;
+            continue;
+        }
+        if (strcmp(argv[arg], "-T") == 0 && arg + 1 < argc) {
+            tracePath = argv[arg+1];
+            arg += 2;
+            continue;
+        }
+        if (strcmp(argv[arg], "-i") == 0) {
+            skipIdle = 1;
+            arg++;
+            continue;
+        }
+        if (arg + 1 >= argc || !parseCount(argv[arg+1], &value)) {
+            fprintf(stderr, "Invalid value for %s\n", argv[arg]);
+            exit(1);
+        }
+
+        if (strcmp(argv[arg], "-n") == 0) {
+            numInstances = value;
+        } else if (strcmp(argv[arg], "-t") == 0) {
+            numThreads = value;
+        } else if (strcmp(argv[arg], "-c") == 0) {
+            cycles = value;
+        } else if (strcmp(argv[arg], "-f") == 0) {
+            frames = value;
+        } else if (strcmp(argv[arg], "-s") == 0) {
+            seed = value;
+        } else if (strcmp(argv[arg], "-r") == 0) {
+            instructionsPerFrame = value > 0 ? value : 1;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    int numROMs = argc - arg;
+    if (numROMs < 1) {
+        fprintf(stderr, "Usage: ./headless [-n INSTANCES] [-t THREADS] [-c CYCLES | -f FRAMES] [-r INSTRUCTIONS PER FRAME] [-e ENGINE [-i] | -l] [-q QUIRKS] [-s SEED] [-T TRACE FILE] [ROM PATH]...\n");
+        exit(1);
+    }
+    if (lockstep && skipIdle) {
+        fprintf(stderr, "-i is not supported by the lockstep engine\n");
+        exit(1);
+    }
+    if (tracePath != NULL && (engineType != ENGINE_INTERPRETER || lockstep || skipIdle)) {
+        fprintf(stderr, "-T only traces the interpreter engine, without -l or -i\n");
+        exit(1);
+    }
+    if (quirks != QUIRKS_DEFAULT && (engineType != ENGINE_INTERPRETER || lockstep || skipIdle)) {
+        fprintf(stderr, "-q only applies to the interpreter engine, without -l or -i\n");
+        exit(1);
+    }
+    if (frames > 0) // a frame budget is just a cycle budget in whole frames
+        cycles = frames * instructionsPerFrame;
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > MAX_THREADS)
+        numThreads = MAX_THREADS;
+    if (numThreads > numInstances)
+        numThreads = numInstances;
+
+    // load each ROM once, then copy the loaded machine into every instance that runs it (instances are dealt out round-robin)
+    CHIP8* templates = malloc(numROMs * sizeof(CHIP8));
+    CHIP8* instances = malloc(numInstances * sizeof(CHIP8));
+    if (templates == NULL || instances == NULL) {
+        fprintf(stderr, "Error allocating %lu instances\n", numInstances);
+        exit(1);
+    }
+
+    for (int i = 0; i < numROMs; i++) {
+        initializeEmulator(&templates[i]);
+        if (loadROM(&templates[i], argv[arg + i]))
+            exit(1);
+    }
+    for (unsigned long i = 0; i < numInstances; i++) {
+        instances[i] = templates[i % numROMs];
+        seedRandom(&instances[i], seed + i); // reproducible, but not every copy of a ROM plays the same game
+    }
+
+    Batch batch;
+    batch.instances = instances;
+    batch.numInstances = numInstances;
+    batch.cycles = cycles;
+    batch.instructionsPerFrame = instructionsPerFrame;
+    batch.engineType = engineType;
+    batch.romPaths = (const char**)&argv[arg];
+    batch.numROMs = numROMs;
+    batch.lockstep = lockstep;
+    batch.skipIdle = skipIdle;
+    batch.quirks = quirks;
+    atomic_init(&batch.nextInstance, 0);
+
+    Tracer tracer;
+    batch.tracer = NULL;
+    if (tracePath != NULL) {
+        if (openTracer(&tracer, tracePath, numThreads))
+            exit(1);
+        batch.tracer = &tracer;
+    }
+
+    Worker workers[MAX_THREADS];
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (unsigned long i = 0; i < numThreads; i++) {
+        workers[i].batch = &batch;
+        workers[i].index = i;
+        workers[i].instancesRun = 0;
+        workers[i].instructions = 0;
+        workers[i].vectorSteps = 0;
+        workers[i].vectorInstructions = 0;
+        workers[i].skipped = 0;
+        if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0) {
+            fprintf(stderr, "Error creating worker thread\n");
+            exit(1);
+        }
+    }
+
+    unsigned long long totalInstructions = 0;
+    unsigned long long vectorSteps = 0;
+    unsigned long long vectorInstructions = 0;
+    unsigned long long skipped = 0;
+    for (unsigned long i = 0; i < numThreads; i++) {
+        pthread_join(workers[i].thread, NULL);
+        totalInstructions += workers[i].instructions;
+        vectorSteps += workers[i].vectorSteps;
+        vectorInstructions += workers[i].vectorInstructions;
+        skipped += workers[i].skipped;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (tracePath != NULL && closeTracer(&tracer) == 0)
+        printf("Wrote the trace to %s\n", tracePath);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    for (unsigned long i = 0; i < numThreads; i++)
+        printf("thread %lu: %d instances, %llu instructions\n", i, workers[i].instancesRun, workers[i].instructions);
+    printf("%lu instances of %d ROM(s) on %lu threads: %llu instructions in %.3f s (%.0f instructions/sec)\n",
+        numInstances, numROMs, numThreads, totalInstructions, seconds, totalInstructions / seconds);
+    if (lockstep)
+        printf("lockstep: %.1f%% of instructions ran in vector lanes, %.1f lanes per vector step\n",
+            totalInstructions ? 100.0 * vectorInstructions / totalInstructions : 0.0, vectorSteps ? (double)vectorInstructions / vectorSteps : 0.0);
+    if (skipIdle)
+        printf("idle loops: %.1f%% of instructions skipped\n", totalInstructions ? 100.0 * skipped / totalInstructions : 0.0);
+
+    free(instances);
+    free(templates);
+    return 0;
+}
+
+void* runWorker(void* arg) {
+    Worker* worker = arg;
+    if (worker->batch->lockstep)
+        runLockstepWorker(worker);
+    else
+        runEngineWorker(worker);
+
+    PROFILE_FLUSH(); // this thread's counts would be lost when it exits
+    return NULL;
+}
+
+void runEngineWorker(Worker* worker) {
+    Batch* batch = worker->batch;
+
+    // one engine per worker, reset before each instance (its cache only ever describes the instance being run)
+    Engine engine;
+    if (createEngine(&engine, batch->engineType))
+        exit(1);
+    int loadedROM = -1; // whose AOT module the engine has
+    engine.idle.enabled = batch->skipIdle;
+    if (setQuirkProfile(&engine, batch->quirks))
+        exit(1);
+    if (batch->tracer != NULL)
+        engine.trace = batch->tracer->rings[worker->index];
+
+    // keep taking the next unclaimed instance and run it to the end of its budget
+    // (one instance at a time keeps its ~12 KB of state hot in this core's cache)
+    for (;;) {
+        int index = atomic_fetch_add(&batch->nextInstance, 1);
+        if (index >= batch->numInstances)
+            break;
+
+        CHIP8* chip8 = &batch->instances[index];
+        if (batch->engineType == ENGINE_AOT && index % batch->numROMs != loadedROM) { // instances were dealt out round-robin
+            loadedROM = index % batch->numROMs;
+            if (loadAotModule(engine.aot, batch->romPaths[loadedROM]))
+                exit(1);
+        }
+        resetEngine(&engine);
+        if (engine.trace != NULL)
+            setTraceInstance(engine.trace, index);
+        runCycles(&engine, chip8, batch->cycles, batch->instructionsPerFrame);
+
+        worker->instancesRun++;
+        worker->instructions += batch->cycles;
+    }
+
+    worker->skipped = engine.idle.skipped;
+    destroyEngine(&engine);
+}
+
+void runLockstepWorker(Worker* worker) {
+    // same as runWorker, but instances are taken BATCH_LANES at a time and run together (see batch.h)
+    Batch* batch = worker->batch;
+    LaneGroup group;
+
+    for (;;) {
+        int first = atomic_fetch_add(&batch->nextInstance, BATCH_LANES);
+        if (first >= batch->numInstances)
+            break;
+        int numLanes = batch->numInstances - first < BATCH_LANES ? batch->numInstances - first : BATCH_LANES;
+
+        loadLaneGroup(&group, &batch->instances[first], numLanes);
+        runLockstep(&group, batch->cycles, batch->instructionsPerFrame);
+        storeLaneGroup(&group);
+
+        worker->instancesRun += numLanes;
+        worker->instructions += (unsigned long long)batch->cycles * numLanes;
+        worker->vectorSteps += group.vectorSteps;
+        worker->vectorInstructions += group.vectorInstructions;
+    }
+}
+
+int parseCount(const char* arg, unsigned long* out) {
+    char* end;
+    *out = strtoul(arg, &end, 10);
+    return *arg != '\0' && *end == '\0';
+}
@@ -0,0 +1,64 @@
+#include "headers/chip8.h"
+#include "headers/telemetry.h"
+#include "headers/hud.h"
+
+#include <ctype.h>
+
+/*
+    - the frame telemetry drawn over the game: one line per metric with its p50, p99 and max so far
+    - there is no font library, so text is a 3x5 pixel font drawn as rectangles (one SDL_RenderFillRects per line)
+*/
+
+// one bit per pixel, rows top to bottom, the leftmost pixel of a row in its highest bit. Lowercase is drawn as uppercase
+static const unsigned short glyphs[128] = {
+    ['0'] = 0x7B6F, ['1'] = 0x2C97, ['2'] = 0x73E7, ['3'] = 0x73CF, ['4'] = 0x5BC9, ['5'] = 0x79CF, ['6'] = 0x79EF,
+    ['7'] = 0x7249, ['8'] = 0x7BEF, ['9'] = 0x7BCF, ['A'] = 0x2BED, ['B'] = 0x6BAE, ['C'] = 0x3923, ['D'] = 0x6B6E,
+    ['E'] = 0x79A7, ['F'] = 0x79A4, ['G'] = 0x396B, ['H'] = 0x5BED, ['I'] = 0x7497, ['J'] = 0x126A, ['K'] = 0x5BAD,
+    ['L'] = 0x4927, ['M'] = 0x5FED, ['N'] = 0x6B6D, ['O'] = 0x2B6A, ['P'] = 0x6BA4, ['Q'] = 0x2B73, ['R'] = 0x6BAD,
+    ['S'] = 0x388E, ['T'] = 0x7492, ['U'] = 0x5B6F, ['V'] = 0x5B6A, ['W'] = 0x5BFD, ['X'] = 0x5AAD, ['Y'] = 0x5A92,
+    ['Z'] = 0x72A7, ['.'] = 0x0002, [':'] = 0x0410, ['/'] = 0x12A4, ['-'] = 0x01C0, ['%'] = 0x52A5
+};
+
+void drawHud(SDL_Renderer* renderer, const Telemetry* telemetry) {
+    char lines[NUM_METRICS][HUD_LINE_LENGTH];
+    int longest = 0;
+    for (int metric = 0; metric < NUM_METRICS; metric++) {
+        char p50[16], p99[16], max[16];
+        formatMetric(p50, sizeof(p50), metric, metricPercentile(telemetry, metric, 0.5));
+        formatMetric(p99, sizeof(p99), metric, metricPercentile(telemetry, metric, 0.99));
+        formatMetric(max, sizeof(max), metric, metricMax(telemetry, metric));
+        int length = snprintf(lines[metric], HUD_LINE_LENGTH, "%-15s p50 %-7s p99 %-7s max %s", metricName(metric), p50, p99, max);
+        if (length > longest)
+            longest = length < HUD_LINE_LENGTH ? length : HUD_LINE_LENGTH - 1;
+    }
+
+    // a dark box behind the text so it reads over any screen
+    int advance = (GLYPH_WIDTH + 1) * HUD_SCALE;
+    int lineHeight = (GLYPH_HEIGHT + 2) * HUD_SCALE;
+    SDL_Rect box = { HUD_MARGIN / 2, HUD_MARGIN / 2, longest * advance + HUD_MARGIN, NUM_METRICS * lineHeight + HUD_MARGIN };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 192);
+    SDL_RenderFillRect(renderer, &box);
+
+    SDL_SetRenderDrawColor(renderer, 0, 255, 128, 255);
+    for (int metric = 0; metric < NUM_METRICS; metric++)
+        drawText(renderer, HUD_MARGIN, HUD_MARGIN + metric * lineHeight, lines[metric]);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+}
+
+void drawText(SDL_Renderer* renderer, int x, int y, const char* text) {
+    // in the current draw color, one rectangle per lit font pixel
+    SDL_Rect rects[HUD_LINE_LENGTH * GLYPH_WIDTH * GLYPH_HEIGHT];
+    int numRects = 0;
+    for (int i = 0; text[i] != '\0' && i < HUD_LINE_LENGTH; i++) {
+        unsigned short glyph = glyphs[toupper((unsigned char)text[i]) & 0x7F];
+        for (int bit = 0; bit < GLYPH_WIDTH * GLYPH_HEIGHT; bit++) {
+            if (!(glyph >> (GLYPH_WIDTH * GLYPH_HEIGHT - 1 - bit) & 1))
+                continue;
+            SDL_Rect rect = { x + (i * (GLYPH_WIDTH + 1) + bit % GLYPH_WIDTH) * HUD_SCALE, y + bit / GLYPH_WIDTH * HUD_SCALE,
+                HUD_SCALE, HUD_SCALE };
+            rects[numRects++] = rect;
+        }
+    }
+    SDL_RenderFillRects(renderer, rects, numRects);
+}
@@ -0,0 +1,91 @@
+#include "headers/chip8.h"
+#include "headers/idle.h"
+
+#include <string.h>
+
+void resetIdleDetector(IdleDetector* idle) {
+    idle->wait = 0;
+    idle->backoff = 0;
+    idle->detected = 0;
+    idle->waitingForInput = 0;
+}
+
+static int isIdleInstruction(unsigned short opcode) {
+    // instructions whose only effect is on V, I and pc (whatever they read stays put until the frame ends)
+    switch (opcode & 0xF000) {
+        case 0x0000: return opcode != 0x00E0 && opcode != 0x00EE; // 0nnn does nothing at all
+        case 0x1000: case 0x3000: case 0x4000: case 0x5000: case 0x6000: case 0x7000:
+        case 0x9000: case 0xA000: case 0xB000:
+            return 1;
+        case 0x8000: return (opcode & 0x000F) <= 0x7 || (opcode & 0x000F) == 0xE;
+        case 0xE000: return (opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1;
+        case 0xF000:
+            switch (opcode & 0x00FF) {
+                case 0x07: case 0x0A: case 0x1E: case 0x29: case 0x65:
+                    return 1;
+            }
+            return 0;
+    }
+    return 0; // 2nnn, Cxkk, Dxyn
+}
+
+unsigned long skipIdleLoop(IdleDetector* idle, CHIP8* chip8, unsigned long cycles) {
+    /*
+        - runs the start of a frame through emulateCycle for as long as the instructions are idle ones, looking for
+          pc to come back around with the registers unchanged. When the first pass changes them (Vx picking up the
+          delay timer that just ticked), a second pass shows whether it still changes anything
+        - if it does not, the machine repeats that pass until the frame ends: every whole pass left is skipped
+        - returns how many of the frame's cycles were used up (run or skipped), the caller runs the rest
+    */
+    idle->detected = 0;
+    if (idle->wait > 0) {
+        // a machine that was waiting for a key still is until one changes (it is running the same loop in between)
+        if (memcmp(idle->keyboard, chip8->keyboard, KEYBOARD_SIZE) != 0)
+            idle->waitingForInput = 0;
+        idle->wait--;
+        return 0;
+    }
+    idle->waitingForInput = 0;
+
+    unsigned short start = chip8->pc;
+    unsigned char V[NUM_REGISTERS];
+    memcpy(V, chip8->V, sizeof(V));
+    unsigned short I = chip8->I;
+    unsigned long length = 0;
+    unsigned long executed = 0;
+
+    while (executed < cycles && executed < 2 * MAX_IDLE_LOOP) {
+        unsigned short opcode = (chip8->memory[chip8->pc] << 8) | chip8->memory[chip8->pc+1];
+        if (!isIdleInstruction(opcode))
+            break;
+        emulateCycle(chip8);
+        executed++;
+        if (chip8->pc != start)
+            continue;
+
+        if (I == chip8->I && memcmp(V, chip8->V, sizeof(V)) == 0) {
+            length = executed - length; // from here on, a pass of this many instructions that changes nothing
+            unsigned long remaining = cycles - executed;
+            unsigned long skipped = remaining - remaining % length;
+            idle->skipped += skipped;
+            idle->detected = 1;
+            idle->waitingForInput = chip8->delayTimer == 0 && chip8->soundTimer == 0; // nothing left to change it but a key
+            memcpy(idle->keyboard, chip8->keyboard, KEYBOARD_SIZE);
+            if (skipped > 0) { // otherwise the loop is too long for a frame this short, and probing every frame only costs
+                idle->backoff = 0;
+                return executed + skipped;
+            }
+            break;
+        }
+        if (length > 0) // the second pass changed things as well: it is still doing something
+            break;
+        length = executed;
+        memcpy(V, chip8->V, sizeof(V));
+        I = chip8->I;
+    }
+
+    // not idle, the frame ended before it could tell, or there was nothing to skip: leave it to the engine for a while
+    idle->wait = idle->backoff;
+    idle->backoff = idle->backoff < MAX_IDLE_BACKOFF ? idle->backoff * 2 + 1 : MAX_IDLE_BACKOFF;
+    return executed;
+}
@@ -0,0 +1,80 @@
+#include "headers/chip8.h"
+#include "headers/scheduler.h"
+#include "headers/input.h"
+
+#include <string.h>
+
+void defaultKeymap(Keymap* keymap) {
+    //  1 2 3 C        1 2 3 4
+    //  4 5 6 D   <-   Q W E R
+    //  7 8 9 E        A S D F
+    //  A 0 B F        Z X C V
+    static const SDL_Scancode layout[KEYBOARD_SIZE] = {
+        SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+        SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+        SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+        SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+    };
+    memset(keymap->keys, NO_KEY, sizeof(keymap->keys));
+    for (int key = 0; key < KEYBOARD_SIZE; key++)
+        keymap->keys[layout[key]] = key;
+}
+
+int loadKeymap(Keymap* keymap, const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+
+    memset(keymap->keys, NO_KEY, sizeof(keymap->keys));
+    char line[MAX_KEYMAP_LINE];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        unsigned int key;
+        char name[MAX_KEYMAP_LINE];
+        int fields = sscanf(line, "%x %255[^\n]", &key, name);
+        if (fields <= 0) // blank
+            continue;
+
+        // scancode names can have spaces in them ("Left Shift"), so the name is the rest of the line minus trailing blanks
+        size_t length = fields == 2 ? strlen(name) : 0;
+        while (length > 0 && (name[length-1] == ' ' || name[length-1] == '\t' || name[length-1] == '\r'))
+            name[--length] = '\0';
+        SDL_Scancode scancode = length > 0 ? SDL_GetScancodeFromName(name) : SDL_SCANCODE_UNKNOWN;
+        if (key >= KEYBOARD_SIZE || scancode == SDL_SCANCODE_UNKNOWN) {
+            fprintf(stderr, "%s:%d: expected <CHIP-8 key 0-F> <SDL scancode name>\n", filename, lineNumber);
+            fclose(file);
+            return 1;
+        }
+        keymap->keys[scancode] = key;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void initializeLatency(LatencyStats* stats) {
+    stats->count = 0;
+    stats->total = 0;
+    stats->max = 0;
+}
+
+void recordLatency(LatencyStats* stats, unsigned long long nanoseconds) {
+    stats->count++;
+    stats->total += nanoseconds;
+    if (nanoseconds > stats->max)
+        stats->max = nanoseconds;
+}
+
+void printLatency(const char* name, const LatencyStats* stats) {
+    if (stats->count == 0)
+        return;
+    printf("%s: %.1f ms average, %.1f ms worst over %llu key changes (a frame is %.1f ms)\n", name,
+        stats->total / 1e6 / stats->count, stats->max / 1e6, stats->count, 1e3 / TIMER_HZ);
+}
@@ -0,0 +1,671 @@
+#include "headers/chip8.h"
+#include "headers/jit.h"
+
+#include <limits.h>
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+/*
+    - the JIT turns straight-line runs of CHIP8 instructions into x86-64 code, one block per start address
+    - a block ends after a jump, call, return or skip (those work out the next pc), at an instruction the JIT
+      does not translate (Dxyn, Ex9E/ExA1, Fx0A, Cxkk, 00E0, Fx33, Fx55), or after JIT_MAX_BLOCK_LENGTH instructions
+    - inside a block pc is a constant, I lives in edx and the block's most-used V registers live in r8b - r11b;
+      everything is written back to the CHIP8 struct on the way out
+    - blocks count down the budget they are given and leave early when it runs out, so a frame always executes
+      exactly the number of instructions the scheduler asked for, just like emulateCycle
+    - Fx33 and Fx55 always run through emulateCycle; if they write over bytes a block was built from, the whole cache is dropped
+    - the code buffer is never writable and executable at once: it is made writable while a block is emitted (and its
+      jumps patched), then executable again before anything runs
+*/
+
+#ifdef JIT_X86_64
+
+// host registers
+enum { RAX = 0, RCX = 1, RDX = 2, RSI = 6, RDI = 7, R8 = 8 };
+
+#define REG_CHIP8 RDI // first argument: the CHIP8 struct, base of every memory operand
+#define REG_BUDGET RSI // second argument: instructions left to run
+#define REG_I RDX
+
+// condition codes (for jcc, setcc and cmovcc)
+#define CC_E 0x4
+#define CC_NE 0x5
+#define CC_A 0x7
+
+// opcodes of the two-operand 8-bit instructions ("op r/m8, r8" form; +2 gives the "op r8, r/m8" form)
+#define OP8_ADD 0x00
+#define OP8_OR 0x08
+#define OP8_AND 0x20
+#define OP8_SUB 0x28
+#define OP8_XOR 0x30
+#define OP8_CMP 0x38
+#define OP8_MOV 0x88
+
+// /digit of the same operations for the "op r/m, imm" form
+#define ALU_ADD 0
+#define ALU_AND 4
+#define ALU_SUB 5
+#define ALU_CMP 7
+
+#define SHIFT_SHL 4
+#define SHIFT_SHR 5
+
+typedef struct {
+    int isRegister;
+    int reg; // the register, or the base register of a memory operand
+    int index; // index register of a memory operand (-1 for none)
+    int scale; // log2 of the index scale
+    int disp;
+} Operand;
+
+typedef struct {
+    unsigned char* p;
+    unsigned char* end;
+    int overflow;
+} Emitter;
+
+typedef struct {
+    Emitter e;
+    int cached[NUM_REGISTERS]; // host register holding each V register, or -1 when it stays in memory
+    int usesI;
+    int writesI;
+    unsigned char* sideExits[JIT_MAX_BLOCK_LENGTH]; // jz rel32 fields to patch, one per instruction boundary
+    unsigned char* epilogueJumps[JIT_MAX_BLOCK_LENGTH];
+} Compiler;
+
+static Operand reg(int r) {
+    Operand op = { 1, r, -1, 0, 0 };
+    return op;
+}
+
+static Operand field(int offset) {
+    Operand op = { 0, REG_CHIP8, -1, 0, offset };
+    return op;
+}
+
+static Operand indexed(int base, int index, int scale, int offset) {
+    Operand op = { 0, base, index, scale, offset };
+    return op;
+}
+
+static Operand vRegister(Compiler* c, int x) {
+    if (c->cached[x] >= 0)
+        return reg(c->cached[x]);
+    return field(offsetof(CHIP8, V) + x);
+}
+
+static void emitByte(Emitter* e, unsigned char byte) {
+    if (e->p < e->end)
+        *e->p++ = byte;
+    else
+        e->overflow = 1;
+}
+
+static void emit16(Emitter* e, unsigned short value) {
+    emitByte(e, value & 0xFF);
+    emitByte(e, value >> 8);
+}
+
+static void emit32(Emitter* e, unsigned int value) {
+    for (int i = 0; i < 4; i++)
+        emitByte(e, (value >> (8 * i)) & 0xFF);
+}
+
+static void patch32(unsigned char* at, int value) {
+    memcpy(at, &value, 4);
+}
+
+// prefixes, opcode and ModRM/SIB/disp32 of one instruction. regField is a register or a /digit.
+// byteOperands forces a REX prefix when spl/bpl/sil/dil would otherwise be read as ah/ch/dh/bh
+static void emitInstruction(Emitter* e, int operand16, int rexW, int byteOperands, const unsigned char* opcode, int opcodeLength, int regField, Operand rm) {
+    if (operand16)
+        emitByte(e, 0x66);
+
+    int rex = 0;
+    if (rexW)
+        rex |= 0x08;
+    if (regField & 8)
+        rex |= 0x04;
+    if (!rm.isRegister && rm.index >= 0 && (rm.index & 8))
+        rex |= 0x02;
+    if (rm.reg & 8)
+        rex |= 0x01;
+    if (rex || (byteOperands && ((regField >= 4 && regField < 8) || (rm.isRegister && rm.reg >= 4 && rm.reg < 8))))
+        emitByte(e, 0x40 | rex);
+
+    for (int i = 0; i < opcodeLength; i++)
+        emitByte(e, opcode[i]);
+
+    if (rm.isRegister) {
+        emitByte(e, 0xC0 | ((regField & 7) << 3) | (rm.reg & 7));
+        return;
+    }
+
+    // always [base + disp32] or [base + index * scale + disp32] (the base is never rsp/rbp/r12/r13, which need special forms)
+    if (rm.index >= 0) {
+        emitByte(e, 0x80 | ((regField & 7) << 3) | 4);
+        emitByte(e, (rm.scale << 6) | ((rm.index & 7) << 3) | (rm.reg & 7));
+    } else {
+        emitByte(e, 0x80 | ((regField & 7) << 3) | (rm.reg & 7));
+    }
+    emit32(e, rm.disp);
+}
+
+static void emitOp(Emitter* e, int byteOperands, unsigned char opcode, int regField, Operand rm) {
+    emitInstruction(e, 0, 0, byteOperands, &opcode, 1, regField, rm);
+}
+
+static void emitOp0F(Emitter* e, int byteOperands, unsigned char opcode, int regField, Operand rm) {
+    unsigned char bytes[2] = { 0x0F, opcode };
+    emitInstruction(e, 0, 0, byteOperands, bytes, 2, regField, rm);
+}
+
+// dst = dst OP src on bytes, whatever mix of host registers and memory the operands are (al is the scratch register)
+static void binary8(Emitter* e, unsigned char opcode, Operand dst, Operand src) {
+    if (src.isRegister) {
+        emitOp(e, 1, opcode, src.reg, dst);
+    } else if (dst.isRegister) {
+        emitOp(e, 1, opcode + 2, dst.reg, src);
+    } else {
+        emitOp(e, 1, OP8_MOV + 2, RAX, src);
+        emitOp(e, 1, opcode, RAX, dst);
+    }
+}
+
+static void aluImm8(Emitter* e, int digit, Operand dst, unsigned char imm) {
+    emitOp(e, 1, 0x80, digit, dst);
+    emitByte(e, imm);
+}
+
+static void movImm8(Emitter* e, Operand dst, unsigned char imm) {
+    emitOp(e, 1, 0xC6, 0, dst);
+    emitByte(e, imm);
+}
+
+static void shift8(Emitter* e, int digit, Operand dst, int count) {
+    if (count == 1) {
+        emitOp(e, 1, 0xD0, digit, dst);
+    } else {
+        emitOp(e, 1, 0xC0, digit, dst);
+        emitByte(e, count);
+    }
+}
+
+static void setcc(Emitter* e, int cc, Operand dst) {
+    emitOp0F(e, 1, 0x90 + cc, 0, dst);
+}
+
+static void movzx8(Emitter* e, int dst, Operand src) {
+    emitOp0F(e, 1, 0xB6, dst, src);
+}
+
+static void movzx16(Emitter* e, int dst, Operand src) {
+    emitOp0F(e, 0, 0xB7, dst, src);
+}
+
+static void cmovcc(Emitter* e, int cc, int dst, Operand src) {
+    emitOp0F(e, 0, 0x40 + cc, dst, src);
+}
+
+static void movImm32(Emitter* e, int dst, unsigned int imm) {
+    if (dst & 8)
+        emitByte(e, 0x41);
+    emitByte(e, 0xB8 + (dst & 7));
+    emit32(e, imm);
+}
+
+static void add32(Emitter* e, int dst, int src) {
+    emitOp(e, 0, 0x01, src, reg(dst));
+}
+
+static void addImm32(Emitter* e, int dst, unsigned int imm) {
+    emitOp(e, 0, 0x81, ALU_ADD, reg(dst));
+    emit32(e, imm);
+}
+
+static void store16(Emitter* e, Operand dst, int src) {
+    unsigned char opcode = 0x89;
+    emitInstruction(e, 1, 0, 0, &opcode, 1, src, dst);
+}
+
+static void store16Imm(Emitter* e, Operand dst, unsigned short imm) {
+    unsigned char opcode = 0xC7;
+    emitInstruction(e, 1, 0, 0, &opcode, 1, 0, dst);
+    emit16(e, imm);
+}
+
+// jz/jmp with a rel32 to fill in later: returns where the rel32 is
+static unsigned char* jumpPlaceholder(Emitter* e, int conditional) {
+    if (conditional) {
+        emitByte(e, 0x0F);
+        emitByte(e, 0x80 + CC_E);
+    } else {
+        emitByte(e, 0xE9);
+    }
+    unsigned char* at = e->p;
+    emit32(e, 0);
+    return at;
+}
+
+static void patchJump(Emitter* e, unsigned char* at, unsigned char* target) {
+    if (!e->overflow)
+        patch32(at, (int)(target - (at + 4)));
+}
+
+// what the JIT does with each opcode: 0 = leave it to emulateCycle, 1 = translate, 2 = translate and end the block
+static int classify(unsigned short opcode) {
+    unsigned short kk = opcode & 0x00FF;
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            return opcode == 0x00EE ? 2 : 0;
+        case 0x1000: case 0x2000: case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xB000:
+            return 2;
+        case 0x6000: case 0x7000: case 0xA000:
+            return 1;
+        case 0x8000:
+            switch(opcode & 0x000F) {
+                case 0x0: case 0x1: case 0x2: case 0x3: case 0x4: case 0x5: case 0x6: case 0x7: case 0xE:
+                    return 1;
+            }
+            return 0;
+        case 0xF000:
+            return (kk == 0x07 || kk == 0x15 || kk == 0x18 || kk == 0x1E || kk == 0x29 || kk == 0x65) ? 1 : 0;
+    }
+    return 0; // Cxkk, Dxyn, Ex9E, ExA1
+}
+
+static void countUses(int* uses, unsigned short opcode) {
+    int x = (opcode & 0x0F00) >> 8;
+    int y = (opcode & 0x00F0) >> 4;
+    switch(opcode & 0xF000) {
+        case 0x3000: case 0x4000: case 0x6000: case 0x7000:
+            uses[x]++;
+            break;
+        case 0x5000: case 0x9000:
+            uses[x]++;
+            uses[y]++;
+            break;
+        case 0x8000:
+            uses[x] += 2;
+            uses[y]++;
+            uses[0xF]++;
+            break;
+        case 0xB000:
+            uses[0]++;
+            break;
+        case 0xF000:
+            if ((opcode & 0x00FF) == 0x65) {
+                for (int i = 0; i <= x; i++)
+                    uses[i]++;
+            } else {
+                uses[x]++;
+            }
+            break;
+    }
+}
+
+// emits one instruction at address; terminators leave the next pc in eax
+static void compileInstruction(Compiler* c, unsigned short opcode, unsigned short address) {
+    Emitter* e = &c->e;
+    int x = (opcode & 0x0F00) >> 8;
+    int y = (opcode & 0x00F0) >> 4;
+    unsigned char kk = opcode & 0x00FF;
+    unsigned short nnn = opcode & 0x0FFF;
+    Operand vx = vRegister(c, x);
+    Operand vy = vRegister(c, y);
+    Operand vf = vRegister(c, 0xF);
+    Operand sp = field(offsetof(CHIP8, sp));
+
+    switch(opcode & 0xF000) {
+        case 0x0000: // 00EE - RET
+            aluImm8(e, ALU_SUB, sp, 1);
+            movzx8(e, RCX, sp);
+            movzx16(e, RAX, indexed(REG_CHIP8, RCX, 1, offsetof(CHIP8, stack)));
+            addImm32(e, RAX, 2);
+            break;
+        case 0x1000: // 1nnn - JP addr
+            movImm32(e, RAX, nnn);
+            break;
+        case 0x2000: // 2nnn - CALL addr
+            movzx8(e, RCX, sp);
+            store16Imm(e, indexed(REG_CHIP8, RCX, 1, offsetof(CHIP8, stack)), address);
+            aluImm8(e, ALU_ADD, sp, 1);
+            movImm32(e, RAX, nnn);
+            break;
+        case 0x3000: case 0x4000: case 0x5000: case 0x9000: // skips: compare first (it may use al), then pick pc + 2 or pc + 4
+            if ((opcode & 0xF000) == 0x3000 || (opcode & 0xF000) == 0x4000)
+                aluImm8(e, ALU_CMP, vx, kk);
+            else
+                binary8(e, OP8_CMP, vx, vy);
+            movImm32(e, RAX, address + 2);
+            movImm32(e, RCX, address + 4);
+            cmovcc(e, ((opcode & 0xF000) == 0x3000 || (opcode & 0xF000) == 0x5000) ? CC_E : CC_NE, RAX, reg(RCX));
+            break;
+        case 0x6000: // 6xkk - LD Vx, byte
+            movImm8(e, vx, kk);
+            break;
+        case 0x7000: // 7xkk - ADD Vx, byte
+            aluImm8(e, ALU_ADD, vx, kk);
+            break;
+        case 0x8000: // same order of reads and writes as emulateCycle, which matters when x or y is F
+            switch(opcode & 0x000F) {
+                case 0x0:
+                    binary8(e, OP8_MOV, vx, vy);
+                    break;
+                case 0x1:
+                    binary8(e, OP8_OR, vx, vy);
+                    break;
+                case 0x2:
+                    binary8(e, OP8_AND, vx, vy);
+                    break;
+                case 0x3:
+                    binary8(e, OP8_XOR, vx, vy);
+                    break;
+                case 0x4: // emulateCycle leaves VF = 0 whether or not the add carries
+                    movImm8(e, vf, 0);
+                    binary8(e, OP8_ADD, vx, vy);
+                    break;
+                case 0x5:
+                    movImm8(e, vf, 0);
+                    binary8(e, OP8_CMP, vx, vy);
+                    setcc(e, CC_A, vf);
+                    binary8(e, OP8_SUB, vx, vy);
+                    break;
+                case 0x6:
+                    binary8(e, OP8_MOV, reg(RAX), vx);
+                    aluImm8(e, ALU_AND, reg(RAX), 1);
+                    binary8(e, OP8_MOV, vf, reg(RAX));
+                    shift8(e, SHIFT_SHR, vx, 1);
+                    break;
+                case 0x7:
+                    movImm8(e, vf, 0);
+                    binary8(e, OP8_CMP, vy, vx);
+                    setcc(e, CC_A, vf);
+                    binary8(e, OP8_MOV, reg(RAX), vy);
+                    binary8(e, OP8_SUB, reg(RAX), vx);
+                    binary8(e, OP8_MOV, vx, reg(RAX));
+                    break;
+                case 0xE:
+                    binary8(e, OP8_MOV, reg(RAX), vx);
+                    shift8(e, SHIFT_SHR, reg(RAX), 7);
+                    binary8(e, OP8_MOV, vf, reg(RAX));
+                    shift8(e, SHIFT_SHL, vx, 1);
+                    break;
+            }
+            break;
+        case 0xA000: // Annn - LD I, addr
+            movImm32(e, REG_I, nnn);
+            break;
+        case 0xB000: // Bnnn - JP V0, addr
+            movzx8(e, RAX, vRegister(c, 0));
+            addImm32(e, RAX, nnn);
+            break;
+        case 0xF000:
+            switch(kk) {
+                case 0x07:
+                    binary8(e, OP8_MOV, vx, field(offsetof(CHIP8, delayTimer)));
+                    break;
+                case 0x15:
+                    binary8(e, OP8_MOV, field(offsetof(CHIP8, delayTimer)), vx);
+                    break;
+                case 0x18:
+                    binary8(e, OP8_MOV, field(offsetof(CHIP8, soundTimer)), vx);
+                    break;
+                case 0x1E: // I is 16 bits wide, so wrap it after the add
+                    movzx8(e, RAX, vx);
+                    add32(e, REG_I, RAX);
+                    movzx16(e, REG_I, reg(REG_I));
+                    break;
+                case 0x29: // I = 0x50 + Vx * 5
+                    movzx8(e, RAX, vx);
+                    emitOp(e, 0, 0x8D, REG_I, indexed(RAX, RAX, 2, 0x50));
+                    break;
+                case 0x65:
+                    for (int i = 0; i <= x; i++) {
+                        binary8(e, OP8_MOV, reg(RAX), indexed(REG_CHIP8, REG_I, 0, offsetof(CHIP8, memory) + i));
+                        binary8(e, OP8_MOV, vRegister(c, i), reg(RAX));
+                    }
+                    break;
+            }
+            break;
+    }
+}
+
+static int protectCode(JitCache* jit, int prot) {
+    if (mprotect(jit->code, JIT_CODE_SIZE, prot) != 0) {
+        fprintf(stderr, "Error changing the protection of the JIT code buffer\n");
+        return 1;
+    }
+    return 0;
+}
+
+static JitBlockFn emitBlock(JitCache* jit, const unsigned short* opcodes, int count, int terminated, unsigned short start, unsigned short address) {
+    // writes the block into the code buffer, which must be writable
+    Compiler c;
+    c.e.p = jit->code + jit->codeUsed;
+    c.e.end = jit->code + JIT_CODE_SIZE;
+    c.e.overflow = 0;
+    c.usesI = 0;
+    c.writesI = 0;
+
+    // keep the most-used V registers of the block in r8b - r11b
+    int uses[NUM_REGISTERS] = { 0 };
+    for (int i = 0; i < count; i++) {
+        countUses(uses, opcodes[i]);
+        unsigned short top = opcodes[i] & 0xF0FF;
+        if ((opcodes[i] & 0xF000) == 0xA000 || top == 0xF01E || top == 0xF029)
+            c.usesI = c.writesI = 1;
+        if (top == 0xF065)
+            c.usesI = 1;
+    }
+    for (int i = 0; i < NUM_REGISTERS; i++)
+        c.cached[i] = -1;
+    for (int hostRegister = 0; hostRegister < JIT_CACHED_REGISTERS; hostRegister++) {
+        int best = -1;
+        for (int i = 0; i < NUM_REGISTERS; i++)
+            if (c.cached[i] < 0 && uses[i] >= 2 && (best < 0 || uses[i] > uses[best]))
+                best = i;
+        if (best < 0)
+            break;
+        c.cached[best] = R8 + hostRegister;
+    }
+
+    unsigned char* entry = c.e.p;
+    Emitter* e = &c.e;
+
+    // prologue: load the cached registers
+    for (int i = 0; i < NUM_REGISTERS; i++)
+        if (c.cached[i] >= 0)
+            binary8(e, OP8_MOV, reg(c.cached[i]), field(offsetof(CHIP8, V) + i));
+    if (c.usesI)
+        movzx16(e, REG_I, field(offsetof(CHIP8, I)));
+
+    // body: one budget check between every two instructions
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            emitOp(e, 0, 0xFF, 1, reg(REG_BUDGET)); // dec esi
+            c.sideExits[i] = jumpPlaceholder(e, 1);
+        }
+        compileInstruction(&c, opcodes[i], start + 2 * i);
+    }
+    emitOp(e, 0, 0xFF, 1, reg(REG_BUDGET));
+    if (!terminated)
+        movImm32(e, RAX, address);
+
+    // epilogue: write everything back, pc is in eax, return the budget that is left
+    unsigned char* epilogue = e->p;
+    for (int i = 0; i < NUM_REGISTERS; i++)
+        if (c.cached[i] >= 0)
+            binary8(e, OP8_MOV, field(offsetof(CHIP8, V) + i), reg(c.cached[i]));
+    if (c.writesI)
+        store16(e, field(offsetof(CHIP8, I)), REG_I);
+    store16(e, field(offsetof(CHIP8, pc)), RAX);
+    emitOp(e, 0, 0x89, REG_BUDGET, reg(RAX)); // mov eax, esi
+    emitByte(e, 0xC3); // ret
+
+    // side exits: the budget ran out before instruction i
+    for (int i = 1; i < count; i++) {
+        patchJump(e, c.sideExits[i], e->p);
+        movImm32(e, RAX, start + 2 * i);
+        patchJump(e, jumpPlaceholder(e, 0), epilogue);
+    }
+
+    if (e->overflow)
+        return NULL;
+
+    jit->codeUsed = e->p - jit->code;
+    memset(&jit->covered[start], 1, 2 * count);
+    return (JitBlockFn)entry;
+}
+
+static JitBlockFn compileBlock(JitCache* jit, const unsigned char* memory, unsigned short start, int* length) {
+    unsigned short opcodes[JIT_MAX_BLOCK_LENGTH];
+    int count = 0;
+    int terminated = 0;
+
+    // find the instructions of the block
+    unsigned short address = start;
+    while (count < JIT_MAX_BLOCK_LENGTH && address + 1 < MEMORY_SIZE) {
+        unsigned short opcode = (memory[address] << 8) | memory[address + 1];
+        int kind = classify(opcode);
+        if (kind == 0)
+            break;
+        opcodes[count++] = opcode;
+        address += 2;
+        if (kind == 2) {
+            terminated = 1;
+            break;
+        }
+    }
+
+    *length = count;
+    if (count == 0 || protectCode(jit, PROT_READ | PROT_WRITE))
+        return NULL;
+    JitBlockFn block = emitBlock(jit, opcodes, count, terminated, start, address);
+    if (protectCode(jit, PROT_READ | PROT_EXEC))
+        return NULL;
+    return block;
+}
+
+int jitSupported() {
+    return 1;
+}
+
+JitCache* createJitCache() {
+    JitCache* jit = malloc(sizeof(JitCache));
+    if (jit == NULL) {
+        fprintf(stderr, "Error allocating the JIT cache\n");
+        return NULL;
+    }
+
+    jit->code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        fprintf(stderr, "Error mapping the JIT code buffer\n");
+        free(jit);
+        return NULL;
+    }
+
+    clearJitCache(jit);
+    return jit;
+}
+
+void destroyJitCache(JitCache* jit) {
+    if (jit == NULL)
+        return;
+    munmap(jit->code, JIT_CODE_SIZE);
+    free(jit);
+}
+
+void clearJitCache(JitCache* jit) {
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+    memset(jit->covered, 0, sizeof(jit->covered));
+    jit->codeUsed = 0;
+}
+
+void invalidateJitCache(JitCache* jit, unsigned short address, unsigned short length) {
+    // blocks overlap each other freely, so rather than track which ones a byte belongs to, drop them all
+    for (int i = 0; i < length; i++) {
+        if (jit->covered[(address + i) & (MEMORY_SIZE - 1)]) {
+            clearJitCache(jit);
+            return;
+        }
+    }
+}
+
+void runJit(CHIP8* chip8, JitCache* jit, unsigned long cycles) {
+    while (cycles > 0) {
+        unsigned short pc = chip8->pc;
+
+        if (pc + 1 < MEMORY_SIZE) {
+            JitBlock* block = &jit->blocks[pc];
+            if (block->status == JIT_BLOCK_EMPTY) {
+                int length;
+                block->code = compileBlock(jit, chip8->memory, pc, &length);
+                if (block->code == NULL && length > 0) { // out of code space: start over with an empty buffer
+                    clearJitCache(jit);
+                    block->code = compileBlock(jit, chip8->memory, pc, &length);
+                }
+                block->status = block->code != NULL ? JIT_BLOCK_COMPILED : JIT_BLOCK_INTERPRET;
+                jit->covered[pc] = jit->covered[pc + 1] = 1;
+            }
+
+            if (block->status == JIT_BLOCK_COMPILED) {
+                int budget = cycles > INT_MAX ? INT_MAX : (int)cycles;
+                cycles -= budget - block->code(chip8, budget);
+                continue;
+            }
+        }
+
+        // everything else goes through the interpreter; Fx33 and Fx55 may have written over compiled code
+        unsigned short opcode = (chip8->memory[pc] << 8) | chip8->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+        unsigned short written = 0;
+        if ((opcode & 0xF0FF) == 0xF033)
+            written = 3;
+        else if ((opcode & 0xF0FF) == 0xF055)
+            written = ((opcode & 0x0F00) >> 8) + 1;
+
+        unsigned short address = chip8->I;
+        emulateCycle(chip8);
+        cycles--;
+
+        if (written)
+            invalidateJitCache(jit, address, written);
+    }
+}
+
+#else
+
+int jitSupported() {
+    return 0;
+}
+
+JitCache* createJitCache() {
+    fprintf(stderr, "The JIT is only available on x86-64\n");
+    return NULL;
+}
+
+void destroyJitCache(JitCache* jit) {
+    (void)jit;
+}
+
+void clearJitCache(JitCache* jit) {
+    (void)jit;
+}
+
+void invalidateJitCache(JitCache* jit, unsigned short address, unsigned short length) {
+    (void)jit;
+    (void)address;
+    (void)length;
+}
+
+void runJit(CHIP8* chip8, JitCache* jit, unsigned long cycles) {
+    (void)jit;
+    for (unsigned long i = 0; i < cycles; i++)
+        emulateCycle(chip8);
+}
+
+#endif
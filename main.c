@@ -1,9 +1,66 @@
 #include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/telemetry.h"
+#include "headers/present.h"
+#include "headers/rewind.h"
+#include "headers/recording.h"
+#include "headers/frames.h"
+#include "headers/audio.h"
+#include "headers/input.h"
+#include "headers/hud.h"
 #include "headers/main.h"
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: ./main [ROM PATH]\n");
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    int turbo = 0;
+    int rewindSeconds = DEFAULT_REWIND_SECONDS;
+    int recording = 0;
+    int audioBuffer = DEFAULT_AUDIO_BUFFER;
+    const char* keymapPath = NULL;
+    int showHud = 0;
+    EngineType engineType = ENGINE_PREDECODE;
+    const char* tracePath = NULL;
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+
+    // parse the options, the last argument is the ROM path
+    int arg = 1;
+    while (arg < argc - 1) {
+        if (strcmp(argv[arg], "--turbo") == 0) {
+            turbo = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--record") == 0) {
+            recording = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--hud") == 0) {
+            showHud = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--engine") == 0 && arg + 2 < argc && parseEngineType(argv[arg+1], &engineType)) {
+            arg += 2;
+        } else if (strcmp(argv[arg], "--rewind") == 0 && arg + 2 < argc && atoi(argv[arg+1]) >= 0) {
+            rewindSeconds = atoi(argv[arg+1]);
+            arg += 2;
+        } else if (strcmp(argv[arg], "--quirks") == 0 && arg + 2 < argc && parseQuirkProfile(argv[arg+1], &quirks)) {
+            arg += 2;
+        } else if (strcmp(argv[arg], "--trace") == 0 && arg + 2 < argc) {
+            tracePath = argv[arg+1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "--keymap") == 0 && arg + 2 < argc) {
+            keymapPath = argv[arg+1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "--audio-buffer") == 0 && arg + 2 < argc && atoi(argv[arg+1]) > 0) {
+            audioBuffer = atoi(argv[arg+1]);
+            arg += 2;
+        } else if (strcmp(argv[arg], "--ipf") == 0 && arg + 2 < argc && atoi(argv[arg+1]) > 0) {
+            instructionsPerFrame = atoi(argv[arg+1]);
+            arg += 2;
+        } else {
+            break;
+        }
+    }
+
+    if (arg != argc - 1) {
+        fprintf(stderr, "Usage: ./main [--ipf INSTRUCTIONS PER FRAME] [--turbo] [--engine ENGINE] [--rewind SECONDS] [--record] [--hud] [--audio-buffer SAMPLES] [--keymap FILE] [--quirks vip|chip48|schip|xochip] [--trace FILE] [ROM PATH]\n");
         exit(1);
     }
     
@@ -13,38 +70,287 @@ int main(int argc, char *argv[]) {
         exit(1);
     }   
 
+    Keymap keymap;
+    defaultKeymap(&keymap);
+    if (keymapPath != NULL && loadKeymap(&keymap, keymapPath))
+        exit(1);
+
     CHIP8 chip8;
     initializeEmulator(&chip8);
-    int loadError = loadROM(&chip8, argv[1]);
+    int loadError = loadROM(&chip8, argv[arg]);
     if (loadError)
         exit(1);
+    unsigned int seed = time(NULL);
+    seedRandom(&chip8, seed); // a different game every time (the headless tools use fixed seeds)
+
+    // every instruction goes to the trace file, see trace.h. Only the interpreter records them, and it runs idle
+    // loops too, so the trace has no gaps. The quirk profiles other than the default also need the plain interpreter
+    int interpreterOnly = tracePath != NULL || quirks != QUIRKS_DEFAULT;
+    if (interpreterOnly && engineType != ENGINE_INTERPRETER) {
+        printf("Running on the interpreter engine (needed for %s)\n", tracePath != NULL ? "tracing" : "the quirk profile");
+        engineType = ENGINE_INTERPRETER;
+    }
+    Tracer tracer;
+    if (tracePath != NULL && openTracer(&tracer, tracePath, 1))
+        exit(1);
+
+    Engine engine;
+    if (createEngine(&engine, engineType))
+        exit(1);
+    if (engineType == ENGINE_AOT && loadAotModule(engine.aot, argv[arg])) // <ROM PATH>.so, see make aot
+        exit(1);
+    engine.idle.enabled = !interpreterOnly; // a ROM spinning on the delay timer or a key costs next to nothing
+    if (setQuirkProfile(&engine, quirks))
+        exit(1);
+    if (tracePath != NULL)
+        engine.trace = tracer.rings[0];
+
+    Scheduler scheduler;
+    initializeScheduler(&scheduler, instructionsPerFrame, turbo);
+
+    // save states go next to the ROM
+    char statePath[4096];
+    snprintf(statePath, sizeof(statePath), "%s.state", argv[arg]);
+
+    // the session's input goes next to the ROM too, for ./replay. Rewinding and loading states would make the
+    // recording disagree with what was played, so both are off while recording
+    char recordingPath[4096];
+    snprintf(recordingPath, sizeof(recordingPath), "%s.input", argv[arg]);
+    Recorder recorder;
+    if (recording) {
+        if (startRecording(&recorder, recordingPath, seed, instructionsPerFrame))
+            exit(1);
+        rewindSeconds = 0;
+    }
 
+    // per-frame timings go next to the ROM as well, as CSV, when the emulator exits
+    char telemetryPath[4096];
+    snprintf(telemetryPath, sizeof(telemetryPath), "%s.telemetry.csv", argv[arg]);
+    static Telemetry telemetry;
+    initializeTelemetry(&telemetry);
+
+    RewindBuffer rewind;
+    if (createRewindBuffer(&rewind, rewindSeconds * TIMER_HZ))
+        exit(1);
+
+    // the emulation runs on its own thread (runCore) and this one keeps SDL: input goes over as atomics,
+    // frames come back through a triple buffer, so a slow present never holds up the emulation or the other way round
+    Beeper beeper;
+    openBeeper(&beeper, audioBuffer);
+
+    Core core;
+    core.chip8 = &chip8;
+    core.engine = &engine;
+    core.scheduler = &scheduler;
+    core.rewind = &rewind;
+    core.recorder = recording ? &recorder : NULL;
+    core.statePath = statePath;
+    core.beeper = &beeper;
+    initializeFrameBuffer(&core.frames);
+    atomic_init(&core.framePending, 0);
+    atomic_init(&core.keys, 0);
+    atomic_init(&core.inputTime, 0);
+    core.lastInput = 0;
+    initializeLatency(&core.pickupLatency);
+    core.telemetry = &telemetry;
+    atomic_init(&core.rewinding, 0);
+    atomic_init(&core.saveRequested, 0);
+    atomic_init(&core.loadRequested, 0);
+    atomic_init(&core.quit, 0);
+    core.wake = SDL_CreateSemaphore(0);
+    if (core.wake == NULL) {
+        fprintf(stderr, "Error creating semaphore: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    Presenter presenter;
+    initializePresenter(&presenter, window, renderer, texture, &telemetry);
+    presenter.showHud = showHud;
+
+    SDL_Thread* coreThread = SDL_CreateThread(runCore, "emulation", &core);
+    if (coreThread == NULL) {
+        fprintf(stderr, "Error creating the emulation thread: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    unsigned char keyboard[KEYBOARD_SIZE] = { 0 };
+    Controls controls = { 0, 0, 0, 0, 0 };
+    const unsigned long long* screen = NULL; // the newest frame from the emulation thread, until it is presented
+    unsigned long long screenInput = 0; // the newest input the emulation had picked up when it made that frame
+    unsigned long long presentedInput = 0;
+    LatencyStats presentLatency; // from a key changing to the first frame made after it reaching the screen
+    initializeLatency(&presentLatency);
     int quit = 0;
-    SDL_Event e;
 
     while (!quit) {
 
-        // emulate the cycle
-        emulateCycle(&chip8);
+        // handle input, and pass whatever changed on to the emulation thread
+        quit = handleInput(&keymap, keyboard, &controls);
 
-        // handle input
-        quit = handleInput(chip8.keyboard);
+        unsigned short keys = keyboardMask(keyboard);
+        int changed = keys != atomic_load(&core.keys);
+        if (changed) { // the time goes first, so the emulation thread never sees new keys with an old time
+            atomic_store(&core.inputTime, monotonicNanoseconds());
+            atomic_store(&core.keys, keys);
+        }
+        changed |= atomic_exchange(&core.rewinding, controls.rewinding) != controls.rewinding;
+        if (controls.saveRequested)
+            atomic_store(&core.saveRequested, 1);
+        if (controls.loadRequested)
+            atomic_store(&core.loadRequested, 1);
+        if (quit)
+            atomic_store(&core.quit, 1);
+        if (changed || controls.saveRequested || controls.loadRequested || quit)
+            SDL_SemPost(core.wake);
+        controls.saveRequested = controls.loadRequested = 0;
+        if (controls.hudToggled) {
+            presenter.showHud = !presenter.showHud;
+            presenter.forceRedraw = 1;
+            controls.hudToggled = 0;
+        }
+        if (controls.redraw) {
+            presenter.forceRedraw = 1;
+            controls.redraw = 0;
+        }
 
-        // render the screen
-        if (chip8.drawFlag) {
-            SDL_UpdateTexture(texture, NULL, chip8.screen, SCREEN_WIDTH * sizeof(unsigned int));
-            SDL_RenderClear(renderer);
-            SDL_RenderCopy(renderer, texture, NULL, NULL);
-            SDL_RenderPresent(renderer);
+        // render the newest frame (at most once per display refresh, and only if something changed). A redraw with no
+        // new frame presents what is already shown
+        atomic_store(&core.framePending, 0);
+        unsigned long long input;
+        const unsigned long long* latest = takeFrame(&core.frames, &input);
+        if (latest != NULL) {
+            screen = latest;
+            screenInput = input;
+        }
+        if (screen == NULL && presenter.forceRedraw) {
+            presentFrame(&presenter, presenter.shown);
+        } else if (screen != NULL && presentFrame(&presenter, screen)) {
+            if (screenInput != presentedInput) {
+                recordLatency(&presentLatency, monotonicNanoseconds() - screenInput);
+                presentedInput = screenInput;
+            }
+            screen = NULL;
         }
 
-        usleep(1500);
+        // the HUD keeps changing while the screen does not, so it is redrawn over the same rows every so often
+        unsigned int timeout = screen != NULL || presenter.forceRedraw ? millisecondsUntilRefresh(&presenter) : IDLE_WAIT_MS;
+        if (presenter.showHud && screen == NULL) {
+            unsigned int sinceLast = (monotonicNanoseconds() - presenter.lastPresent) / NANOSECONDS_PER_MILLISECOND;
+            if (sinceLast >= HUD_REFRESH_MS) {
+                presenter.forceRedraw = 1;
+                presentFrame(&presenter, presenter.shown);
+                sinceLast = 0;
+            }
+            if (timeout > HUD_REFRESH_MS - sinceLast)
+                timeout = HUD_REFRESH_MS - sinceLast;
+        }
+
+        // sleep until something happens: input, the emulation thread announcing a frame, or the refresh a frame waits for
+        SDL_WaitEventTimeout(NULL, timeout);
     }
-    
+
+    SDL_WaitThread(coreThread, NULL);
+    if (tracePath != NULL && closeTracer(&tracer) == 0)
+        printf("Wrote the trace to %s\n", tracePath);
+    closeBeeper(&beeper);
+    printBeeperStats(&beeper);
+    printLatency("input picked up by the emulation", &core.pickupLatency);
+    printLatency("input to present", &presentLatency);
+    printTelemetry(&telemetry);
+    if (writeTelemetry(&telemetry, telemetryPath) == 0)
+        printf("Wrote frame timings to %s\n", telemetryPath);
+    SDL_DestroySemaphore(core.wake);
+
+    if (recording && stopRecording(&recorder) == 0)
+        printf("Recorded input to %s\n", recordingPath);
+    destroyRewindBuffer(&rewind);
+    destroyEngine(&engine);
     closeDisplay();
     return 0;
 }
 
+int runCore(void* data) {
+    Core* core = data;
+    CHIP8* chip8 = core->chip8;
+    notifyFrame(core); // something to show before the ROM draws anything
+
+    unsigned short keys = 0;
+
+    while (!atomic_load(&core->quit)) {
+        int rewinding = atomic_load(&core->rewinding);
+
+        // emulate however many 60Hz frames are due (one per pass in turbo mode), or step back that many while rewinding.
+        // The keys are read once at the start of each frame and stay put for the whole of it
+        int frames = framesDue(core->scheduler);
+        for (int i = 0; i < frames; i++) {
+            unsigned short latest = atomic_load(&core->keys);
+            if (latest != keys) {
+                keys = latest;
+                core->lastInput = atomic_load(&core->inputTime);
+                recordLatency(&core->pickupLatency, monotonicNanoseconds() - core->lastInput);
+            }
+            applyKeyboardMask(chip8->keyboard, keys);
+
+            if (rewinding) {
+                if (rewindFrame(core->rewind, chip8))
+                    resetEngine(core->engine);
+                applyKeyboardMask(chip8->keyboard, keys); // the keys being held now stay held
+            } else {
+                if (core->recorder != NULL)
+                    recordFrame(core->recorder, chip8->keyboard);
+                unsigned long long start = monotonicNanoseconds();
+                unsigned long long skipped = core->engine->idle.skipped;
+                runFrame(core->engine, chip8, core->scheduler->instructionsPerFrame);
+                recordMetric(core->telemetry, METRIC_EMULATION, monotonicNanoseconds() - start);
+                recordMetric(core->telemetry, METRIC_INSTRUCTIONS, core->scheduler->instructionsPerFrame - (core->engine->idle.skipped - skipped));
+                captureFrame(core->rewind, chip8);
+            }
+            updateBeeper(core->beeper, !rewinding && chip8->soundTimer > 0);
+        }
+
+        if (atomic_exchange(&core->saveRequested, 0) && saveState(chip8, core->statePath) == 0)
+            printf("Saved state to %s\n", core->statePath);
+        if (atomic_exchange(&core->loadRequested, 0)) {
+            if (core->recorder != NULL)
+                printf("Loading states is disabled while recording\n");
+            else if (loadState(chip8, core->statePath) == 0) {
+                resetEngine(core->engine);
+                printf("Loaded state from %s\n", core->statePath);
+            }
+        }
+
+        if (chip8->drawFlag) {
+            notifyFrame(core);
+            chip8->drawFlag = 0;
+        }
+
+        // sleep until the next frame is due, or for longer while the ROM is only waiting for a key
+        // (the UI thread posts wake as soon as a key changes, so a key press is never held up). A sleep that runs
+        // to its end should end right as the frame is due: how late it is is the overshoot
+        unsigned long long due = monotonicNanoseconds() + nanosecondsUntilNextFrame(core->scheduler);
+        unsigned int timeout = millisecondsUntilNextFrame(core->scheduler);
+        int waiting = core->engine->idle.waitingForInput && !rewinding;
+        if (waiting)
+            timeout = IDLE_WAIT_MS;
+        if (timeout > 0 && SDL_SemWaitTimeout(core->wake, timeout) == SDL_MUTEX_TIMEDOUT && !waiting) {
+            unsigned long long now = monotonicNanoseconds();
+            recordMetric(core->telemetry, METRIC_OVERSHOOT, now > due ? now - due : 0);
+        }
+    }
+    return 0;
+}
+
+void notifyFrame(Core* core) {
+    // hand the screen to the UI thread, and wake it up unless an earlier frame's event is still waiting to be handled
+    publishFrame(&core->frames, core->chip8->screen, core->lastInput);
+    if (!atomic_exchange(&core->framePending, 1)) {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = SDL_USEREVENT;
+        SDL_PushEvent(&event);
+    }
+}
+
 int initialize() {
     // initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -60,7 +366,7 @@ int initialize() {
     }
 
     // create the renderer
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (renderer == NULL) {
         printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
         return 0;
@@ -83,124 +389,49 @@ void closeDisplay() {
     SDL_Quit();
 }
 
-int handleInput(unsigned char* keyboard) {
+int handleInput(const Keymap* keymap, unsigned char* keyboard, Controls* controls) {
+    // drains everything that came in since the last call (the UI thread only wakes up when there is something)
     int quit = 0;
-    
+
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
-        switch(e.type)
-        {
-            case SDL_QUIT:
-                quit = 1;
+        if (e.type == SDL_QUIT) {
+            quit = 1;
+            continue;
+        }
+        if (e.type == SDL_WINDOWEVENT) {
+            Uint8 event = e.window.event;
+            controls->redraw |= event == SDL_WINDOWEVENT_EXPOSED || event == SDL_WINDOWEVENT_RESTORED || event == SDL_WINDOWEVENT_SIZE_CHANGED;
+            continue;
+        }
+        if (e.type != SDL_KEYDOWN && e.type != SDL_KEYUP)
+            continue;
+        if (e.key.repeat) // a held key is already down; F1, F5 and F7 act once per press
+            continue;
+        int down = e.type == SDL_KEYDOWN;
+
+        // emulator controls first, then whatever the keymap says
+        switch (e.key.keysym.scancode) {
+            case SDL_SCANCODE_ESCAPE:
+                quit |= down;
                 break;
-            case SDL_KEYDOWN:
-                switch (e.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        quit = 1;
-                        break;
-                    case SDLK_x:
-                        keyboard[0] = 1;
-                        break;
-                    case SDLK_1:
-                        keyboard[1] = 1;
-                        break;
-                    case SDLK_2:
-                        keyboard[2] = 1;
-                        break;
-                    case SDLK_3:
-                        keyboard[3] = 1;
-                        break;
-                    case SDLK_q:
-                        keyboard[4] = 1;
-                        break;
-                    case SDLK_w:
-                        keyboard[5] = 1;
-                        break;
-                    case SDLK_e:
-                        keyboard[6] = 1;
-                        break;
-                    case SDLK_a:
-                        keyboard[7] = 1;
-                        break;
-                    case SDLK_s:
-                        keyboard[8] = 1;
-                        break;
-                    case SDLK_d:
-                        keyboard[9] = 1;
-                        break;    
-                    case SDLK_z:
-                        keyboard[0xA] = 1;
-                        break;    
-                    case SDLK_c:
-                        keyboard[0xB] = 1;
-                        break;    
-                    case SDLK_4:
-                        keyboard[0xC] = 1;
-                        break;    
-                    case SDLK_r:
-                        keyboard[0xD] = 1;
-                        break;    
-                    case SDLK_f:
-                        keyboard[0xE] = 1;
-                        break;    
-                    case SDLK_v:
-                        keyboard[0xF] = 1;
-                        break;          
-                }
+            case SDL_SCANCODE_BACKSPACE:
+                controls->rewinding = down;
                 break;
-            case SDL_KEYUP:
-                switch (e.key.keysym.sym) {
-                    case SDLK_x:
-                        keyboard[0] = 0;
-                        break;
-                    case SDLK_1:
-                        keyboard[1] = 0;
-                        break;
-                    case SDLK_2:
-                        keyboard[2] = 0;
-                        break;
-                    case SDLK_3:
-                        keyboard[3] = 0;
-                        break;
-                    case SDLK_q:
-                        keyboard[4] = 0;
-                        break;
-                    case SDLK_w:
-                        keyboard[5] = 0;
-                        break;
-                    case SDLK_e:
-                        keyboard[6] = 0;
-                        break;
-                    case SDLK_a:
-                        keyboard[7] = 0;
-                        break;
-                    case SDLK_s:
-                        keyboard[8] = 0;
-                        break;
-                    case SDLK_d:
-                        keyboard[9] = 0;
-                        break;    
-                    case SDLK_z:
-                        keyboard[0xA] = 0;
-                        break;    
-                    case SDLK_c:
-                        keyboard[0xB] = 0;
-                        break;    
-                    case SDLK_4:
-                        keyboard[0xC] = 0;
-                        break;    
-                    case SDLK_r:
-                        keyboard[0xD] = 0;
-                        break;    
-                    case SDLK_f:
-                        keyboard[0xE] = 0;
-                        break;    
-                    case SDLK_v:
-                        keyboard[0xF] = 0;
-                        break;          
-                }
+            case SDL_SCANCODE_F5:
+                controls->saveRequested |= down;
+                break;
+            case SDL_SCANCODE_F7:
+                controls->loadRequested |= down;
+                break;
+            case SDL_SCANCODE_F1:
+                controls->hudToggled ^= down;
+                break;
+            default:
+                if (keymap->keys[e.key.keysym.scancode] != NO_KEY)
+                    keyboard[keymap->keys[e.key.keysym.scancode]] = down;
                 break;
         }
     }
     return quit;
-}
\ No newline at end of file
+}
@@ -0,0 +1,98 @@
+#include "headers/chip8.h"
+#include "headers/scheduler.h"
+#include "headers/screen.h"
+#include "headers/telemetry.h"
+#include "headers/present.h"
+#include "headers/hud.h"
+
+/*
+    - presents at most once per display refresh, no matter how often the ROM draws
+    - keeps a copy of the rows that are in the texture. Rows that did not change are not uploaded, and if no row
+      changed there is nothing to present at all
+    - changed rows are expanded straight into the texture through SDL_LockTexture, one lock per run of changed rows
+    - the upload and the present are timed into the telemetry, and the HUD is drawn over the screen when it is on
+*/
+
+void initializePresenter(Presenter* presenter, SDL_Window* window, SDL_Renderer* renderer, SDL_Texture* texture, Telemetry* telemetry) {
+    presenter->renderer = renderer;
+    presenter->texture = texture;
+    presenter->lastPresent = 0;
+    presenter->forceRedraw = 1;
+    presenter->telemetry = telemetry;
+    presenter->showHud = 0;
+
+    for (int row = 0; row < SCREEN_HEIGHT; row++)
+        presenter->shown[row] = 0;
+    presenter->refreshNanoseconds = refreshNanoseconds(window);
+}
+
+unsigned long long refreshNanoseconds(SDL_Window* window) {
+    // one refresh of the display the window is on
+    SDL_DisplayMode mode;
+    int refreshRate = DEFAULT_REFRESH_RATE;
+    if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 && mode.refresh_rate > 0)
+        refreshRate = mode.refresh_rate;
+    return NANOSECONDS_PER_SECOND / refreshRate;
+}
+
+int presentFrame(Presenter* presenter, const unsigned long long* screen) {
+    // returns 1 if the frame was dealt with (presented, or identical to what is on screen), 0 if it has to wait for the next refresh
+    unsigned long long now = monotonicNanoseconds();
+    if (now - presenter->lastPresent < presenter->refreshNanoseconds)
+        return 0;
+
+    int uploaded = uploadChangedRows(presenter->texture, 0, 0, screen, presenter->shown);
+    if (!uploaded && !presenter->forceRedraw)
+        return 1;
+
+    unsigned long long presentStart = monotonicNanoseconds();
+    if (uploaded)
+        recordMetric(presenter->telemetry, METRIC_UPLOAD, presentStart - now);
+    SDL_RenderClear(presenter->renderer);
+    SDL_RenderCopy(presenter->renderer, presenter->texture, NULL, NULL);
+    if (presenter->showHud)
+        drawHud(presenter->renderer, presenter->telemetry);
+    SDL_RenderPresent(presenter->renderer);
+    recordMetric(presenter->telemetry, METRIC_PRESENT, monotonicNanoseconds() - presentStart);
+
+    presenter->forceRedraw = 0;
+    presenter->lastPresent = now;
+    return 1;
+}
+
+int uploadChangedRows(SDL_Texture* texture, int x, int y, const unsigned long long* screen, unsigned long long* shown) {
+    // brings the screen-sized area of texture at (x, y) from shown up to screen. Returns 1 if anything was uploaded
+    int uploaded = 0;
+    int row = 0;
+    while (row < SCREEN_HEIGHT) {
+        if (screen[row] == shown[row]) {
+            row++;
+            continue;
+        }
+
+        // upload this run of changed rows
+        int firstRow = row;
+        while (row < SCREEN_HEIGHT && screen[row] != shown[row]) {
+            shown[row] = screen[row];
+            row++;
+        }
+
+        SDL_Rect rect = { x, y + firstRow, SCREEN_WIDTH, row - firstRow };
+        void* pixels;
+        int pitch;
+        if (SDL_LockTexture(texture, &rect, &pixels, &pitch) == 0) {
+            expandRows(screen, pixels, pitch / sizeof(unsigned int), firstRow, row - firstRow);
+            SDL_UnlockTexture(texture);
+        }
+        uploaded = 1;
+    }
+    return uploaded;
+}
+
+unsigned int millisecondsUntilRefresh(const Presenter* presenter) {
+    // how long a frame presentFrame turned down has to wait, rounded up
+    unsigned long long elapsed = monotonicNanoseconds() - presenter->lastPresent;
+    if (elapsed >= presenter->refreshNanoseconds)
+        return 0;
+    return (presenter->refreshNanoseconds - elapsed + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND;
+}
@@ -0,0 +1,129 @@
+#include "headers/chip8.h"
+#include "headers/profile.h"
+
+#ifdef CHIP8_PROFILE
+
+#include "headers/decode.h"
+#include "headers/disasm.h"
+
+#include <pthread.h>
+#include <string.h>
+
+_Thread_local ProfileCounters profileCounters;
+
+static ProfileCounters totals;
+static pthread_mutex_t totalsLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* opNames[NUM_OPS] = {
+    [OP_UNDECODED] = "?",
+    [OP_CLS] = "00E0 CLS", [OP_RET] = "00EE RET", [OP_JP] = "1nnn JP", [OP_CALL] = "2nnn CALL",
+    [OP_SE_BYTE] = "3xkk SE", [OP_SNE_BYTE] = "4xkk SNE", [OP_SE_REG] = "5xy0 SE",
+    [OP_LD_BYTE] = "6xkk LD", [OP_ADD_BYTE] = "7xkk ADD",
+    [OP_LD_REG] = "8xy0 LD", [OP_OR] = "8xy1 OR", [OP_AND] = "8xy2 AND", [OP_XOR] = "8xy3 XOR",
+    [OP_ADD_REG] = "8xy4 ADD", [OP_SUB] = "8xy5 SUB", [OP_SHR] = "8xy6 SHR", [OP_SUBN] = "8xy7 SUBN", [OP_SHL] = "8xyE SHL",
+    [OP_SNE_REG] = "9xy0 SNE", [OP_LD_I] = "Annn LD I", [OP_JP_V0] = "Bnnn JP V0", [OP_RND] = "Cxkk RND", [OP_DRW] = "Dxyn DRW",
+    [OP_SKP] = "Ex9E SKP", [OP_SKNP] = "ExA1 SKNP",
+    [OP_LD_VX_DT] = "Fx07 LD Vx, DT", [OP_LD_VX_K] = "Fx0A LD Vx, K", [OP_LD_DT] = "Fx15 LD DT", [OP_LD_ST] = "Fx18 LD ST",
+    [OP_ADD_I] = "Fx1E ADD I", [OP_LD_F] = "Fx29 LD F", [OP_LD_B] = "Fx33 LD B",
+    [OP_LD_I_VX] = "Fx55 LD [I]", [OP_LD_VX_I] = "Fx65 LD Vx, [I]",
+    [OP_FALLBACK] = "0nnn / unknown"
+};
+
+static void moveSlot(ProfileCounters* into, ProfileCounters* from, int pc) {
+    // credit a slot's count to the opcode and depth in its tag
+    ProfileSlot* slot = &from->slots[pc];
+    unsigned short opcode = slot->tag & 0xFFFF;
+    into->opcodes[((opcode >> 4) & 0xF00) | (opcode & 0xFF)] += slot->count;
+    into->pcs[pc] += slot->count;
+    into->depths[slot->tag >> 16] += slot->count;
+    slot->count = 0;
+}
+
+void retagProfileSlot(ProfileSlot* slot, unsigned int tag) {
+    moveSlot(&profileCounters, &profileCounters, slot - profileCounters.slots);
+    slot->tag = tag;
+}
+
+void flushProfile() {
+    // add this thread's counts to the totals and start it over, so flushing twice never counts anything twice
+    pthread_mutex_lock(&totalsLock);
+    for (int pc = 0; pc < MEMORY_SIZE; pc++) {
+        if (profileCounters.slots[pc].count) {
+            moveSlot(&totals, &profileCounters, pc);
+            totals.slots[pc].tag = profileCounters.slots[pc].tag; // labels the hot spot with what last ran there
+        }
+        totals.opcodes[pc] += profileCounters.opcodes[pc];
+        totals.pcs[pc] += profileCounters.pcs[pc];
+    }
+    for (int i = 0; i < PROFILE_MAX_DEPTH; i++)
+        totals.depths[i] += profileCounters.depths[i];
+    pthread_mutex_unlock(&totalsLock);
+    memset(&profileCounters, 0, sizeof(profileCounters));
+}
+
+static double percent(unsigned long long count, unsigned long long total) {
+    return total ? 100.0 * count / total : 0.0;
+}
+
+static void printReport() {
+    flushProfile(); // whatever the exiting thread ran itself
+
+    unsigned long long total = 0;
+    unsigned long long classes[NUM_OPS] = {0};
+    for (int key = 0; key < MEMORY_SIZE; key++) {
+        if (totals.opcodes[key] == 0)
+            continue;
+        // rebuild an opcode with the same first nibble and low byte (x and y never change the class) and classify it
+        unsigned char bytes[2] = { (key >> 4) & 0xF0, key & 0xFF };
+        classes[decodeOp(bytes, 0).handler] += totals.opcodes[key];
+        total += totals.opcodes[key];
+    }
+    if (total == 0)
+        return;
+
+    fprintf(stderr, "\n=== profile: %llu instructions ===\n", total);
+    fprintf(stderr, "Dxyn: %.2f%% of instructions\n", percent(classes[OP_DRW], total));
+
+    // opcode classes, busiest first (NUM_OPS is small enough for a selection sort)
+    fprintf(stderr, "\n%-18s %15s %8s\n", "class", "count", "%");
+    unsigned char printed[NUM_OPS] = {0};
+    for (;;) {
+        int best = -1;
+        for (int i = 0; i < NUM_OPS; i++)
+            if (!printed[i] && classes[i] && (best < 0 || classes[i] > classes[best]))
+                best = i;
+        if (best < 0)
+            break;
+        printed[best] = 1;
+        fprintf(stderr, "%-18s %15llu %7.2f%%\n", opNames[best], classes[best], percent(classes[best], total));
+    }
+
+    // hottest addresses, labelled with the instruction last run there
+    fprintf(stderr, "\n%-6s %-18s %15s %8s\n", "pc", "instruction", "count", "%");
+    unsigned char shown[MEMORY_SIZE] = {0};
+    for (int row = 0; row < PROFILE_TOP_PCS; row++) {
+        int best = -1;
+        for (int pc = 0; pc < MEMORY_SIZE; pc++)
+            if (!shown[pc] && totals.pcs[pc] && (best < 0 || totals.pcs[pc] > totals.pcs[best]))
+                best = pc;
+        if (best < 0)
+            break;
+        shown[best] = 1;
+        char text[32];
+        disassemble(totals.slots[best].tag & 0xFFFF, text, sizeof(text));
+        fprintf(stderr, "0x%03X  %-18s %15llu %7.2f%%\n", best, text, totals.pcs[best], percent(totals.pcs[best], total));
+    }
+
+    // how deep in subroutines each instruction ran
+    fprintf(stderr, "\n%-6s %15s %8s\n", "sp", "count", "%");
+    for (int depth = 0; depth < PROFILE_MAX_DEPTH; depth++)
+        if (totals.depths[depth])
+            fprintf(stderr, "%-6d %15llu %7.2f%%\n", depth, totals.depths[depth], percent(totals.depths[depth], total));
+}
+
+__attribute__((constructor)) static void registerReport() {
+    // runs before main, so any program built with the profiler reports without having to ask for it
+    atexit(printReport);
+}
+
+#endif
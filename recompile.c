@@ -0,0 +1,291 @@
+#include "headers/chip8.h"
+#include "headers/aot.h"
+#include "headers/disasm.h"
+#include "headers/recompile.h"
+
+/*
+    - static recompiler: ./recompile ROM OUT.c finds the code reachable from 0x200 and writes it out as C, which
+      make <ROM>.so compiles into a module for the aot engine (see aot.h)
+    - reachability follows fallthrough, 1nnn and 2nnn targets, both sides of every skip, and the return address of
+      every call. Bnnn (and 00EE) only know their target at runtime: they jump through a switch over every compiled
+      address, and land in the interpreter if the target was never reached by the analysis
+    - every reached instruction gets a label; straight-line code falls through, jumps are gotos, and V lives in a local
+      array (indices are constants, so the compiler keeps it in registers) that is written back on the way out
+    - each instruction first checks the budget and enabled[] (code written over since loading), the same way the JIT
+      checks its budget, so a frame still runs exactly as many instructions as the scheduler asks for
+*/
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: ./recompile [ROM PATH] [OUTPUT C PATH]\n");
+        exit(1);
+    }
+
+    CHIP8 chip8;
+    initializeEmulator(&chip8);
+    if (loadROM(&chip8, argv[1]))
+        exit(1);
+    struct stat buf;
+    stat(argv[1], &buf);
+
+    Analysis analysis;
+    analyze(chip8.memory, buf.st_size, &analysis);
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Error opening %s for writing\n", argv[2]);
+        exit(1);
+    }
+    emitModule(out, argv[1], chip8.memory, &analysis);
+    if (fclose(out) != 0) {
+        fprintf(stderr, "Error writing %s\n", argv[2]);
+        exit(1);
+    }
+
+    printf("%s: %d instructions compiled, %d left to the interpreter, %d indirect jumps\n",
+        argv[1], analysis.numCompiled, analysis.numExits, analysis.numIndirect);
+    return 0;
+}
+
+static unsigned short fetch(const unsigned char* memory, unsigned short address) {
+    return (memory[address] << 8) | memory[address + 1];
+}
+
+int isExit(unsigned short opcode) {
+    // instructions the module does not run: memory writes (the engine has to see them to invalidate code),
+    // 0nnn (which never advances) and anything emulateCycle does not know (it exits)
+    unsigned short kk = opcode & 0x00FF;
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            return opcode != 0x00E0 && opcode != 0x00EE;
+        case 0x8000:
+            return (opcode & 0x000F) > 0x7 && (opcode & 0x000F) != 0xE;
+        case 0xE000:
+            return kk != 0x9E && kk != 0xA1;
+        case 0xF000:
+            return kk != 0x07 && kk != 0x0A && kk != 0x15 && kk != 0x18 && kk != 0x1E && kk != 0x29 && kk != 0x65;
+    }
+    return 0;
+}
+
+void analyze(const unsigned char* memory, int romSize, Analysis* analysis) {
+    // depth-first walk of the control flow graph from 0x200, restricted to the ROM
+    memset(analysis, 0, sizeof(Analysis));
+    analysis->romSize = romSize;
+    int end = ROM_START + romSize;
+
+    unsigned short stack[MEMORY_SIZE * 2];
+    int top = 0;
+    stack[top++] = ROM_START;
+
+    while (top > 0) {
+        unsigned short address = stack[--top];
+        if (address < ROM_START || address + 1 >= end || analysis->sites[address] != SITE_UNREACHED)
+            continue;
+
+        unsigned short opcode = fetch(memory, address);
+        unsigned short nnn = opcode & 0x0FFF;
+        if (isExit(opcode)) {
+            analysis->sites[address] = SITE_EXIT;
+            analysis->numExits++;
+            if ((opcode & 0xF000) != 0x0000) // 0nnn never moves on; the rest continue with the next instruction
+                stack[top++] = address + 2;
+            continue;
+        }
+        analysis->sites[address] = SITE_COMPILED;
+        analysis->numCompiled++;
+
+        switch(opcode & 0xF000) {
+            case 0x0000:
+                if (opcode == 0x00EE)
+                    analysis->numIndirect++;
+                else
+                    stack[top++] = address + 2;
+                break;
+            case 0x1000:
+                stack[top++] = nnn;
+                break;
+            case 0x2000:
+                stack[top++] = nnn;
+                stack[top++] = address + 2; // where the matching 00EE comes back to
+                break;
+            case 0xB000:
+                analysis->numIndirect++;
+                fprintf(stderr, "warning: indirect jump (Bnnn) at 0x%03X, its targets run in the interpreter unless reached some other way\n", address);
+                break;
+            case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xE000:
+                stack[top++] = address + 2;
+                stack[top++] = address + 4;
+                break;
+            default:
+                stack[top++] = address + 2;
+                break;
+        }
+    }
+}
+
+static void emitJump(FILE* out, const Analysis* analysis, unsigned short target) {
+    // go straight to the target's label if it has one, otherwise leave with pc set to it
+    if (target < MEMORY_SIZE && analysis->sites[target] == SITE_COMPILED)
+        fprintf(out, "goto L%03X;", target);
+    else
+        fprintf(out, "{ pc = 0x%03X; goto leave; }", target);
+}
+
+void emitInstruction(FILE* out, const unsigned char* memory, const Analysis* analysis, unsigned short address, int nextEmitted) {
+    // nextEmitted is the address of the instruction written after this one, so falling through to it needs no goto
+    unsigned short opcode = fetch(memory, address);
+    unsigned short x = (opcode & 0x0F00) >> 8;
+    unsigned short y = (opcode & 0x00F0) >> 4;
+    unsigned short kk = opcode & 0x00FF;
+    unsigned short nnn = opcode & 0x0FFF;
+    int fallsThrough = 1;
+
+    char text[32];
+    disassemble(opcode, text, sizeof(text));
+    if (analysis->sites[address] == SITE_EXIT) { // only ever fallen into
+        fprintf(out, "    // %s\n    pc = 0x%03X; goto leave;\n", text, address);
+        return;
+    }
+    fprintf(out, "L%03X: // %s\n    ENTER(0x%03X);\n    ", address, text, address);
+
+    // every case mirrors emulateCycle statement for statement, so x or y being F works out the same
+    switch(opcode & 0xF000) {
+        case 0x0000:
+            if (opcode == 0x00E0) {
+                fprintf(out, "runtime->clearScreen(chip8);");
+            } else { // 00EE
+                fprintf(out, "chip8->sp--; pc = chip8->stack[chip8->sp] + 2; goto dispatch;");
+                fallsThrough = 0;
+            }
+            break;
+        case 0x1000:
+            emitJump(out, analysis, nnn);
+            fallsThrough = 0;
+            break;
+        case 0x2000:
+            fprintf(out, "chip8->stack[chip8->sp] = 0x%03X; chip8->sp += 1; ", address);
+            emitJump(out, analysis, nnn);
+            fallsThrough = 0;
+            break;
+        case 0x3000: fprintf(out, "if (V[%d] == 0x%02X) ", x, kk); break;
+        case 0x4000: fprintf(out, "if (V[%d] != 0x%02X) ", x, kk); break;
+        case 0x5000: fprintf(out, "if (V[%d] == V[%d]) ", x, y); break;
+        case 0x9000: fprintf(out, "if (V[%d] != V[%d]) ", x, y); break;
+        case 0x6000: fprintf(out, "V[%d] = 0x%02X;", x, kk); break;
+        case 0x7000: fprintf(out, "V[%d] += 0x%02X;", x, kk); break;
+        case 0x8000:
+            switch(opcode & 0x000F) {
+                case 0x0: fprintf(out, "V[%d] = V[%d];", x, y); break;
+                case 0x1: fprintf(out, "V[%d] |= V[%d];", x, y); break;
+                case 0x2: fprintf(out, "V[%d] &= V[%d];", x, y); break;
+                case 0x3: fprintf(out, "V[%d] ^= V[%d];", x, y); break;
+                case 0x4: fprintf(out, "V[15] = 0; V[%d] += V[%d];", x, y); break;
+                case 0x5: fprintf(out, "V[15] = 0; if (V[%d] > V[%d]) V[15] = 1; V[%d] -= V[%d];", x, y, x, y); break;
+                case 0x6: fprintf(out, "V[15] = V[%d] & 0x1; V[%d] >>= 1;", x, x); break;
+                case 0x7: fprintf(out, "V[15] = 0; if (V[%d] > V[%d]) V[15] = 1; V[%d] = V[%d] - V[%d];", y, x, x, y, x); break;
+                case 0xE: fprintf(out, "V[15] = (V[%d] >> 7) & 0x1; V[%d] = V[%d] << 1;", x, x, x); break;
+            }
+            break;
+        case 0xA000: fprintf(out, "I = 0x%03X;", nnn); break;
+        case 0xB000:
+            fprintf(out, "pc = 0x%03X + V[0]; goto dispatch;", nnn);
+            fallsThrough = 0;
+            break;
+        case 0xC000: fprintf(out, "V[%d] = runtime->nextRandom(chip8) & 0x%02X;", x, kk); break;
+        case 0xD000:
+            fprintf(out, "chip8->V[%d] = V[%d]; chip8->V[%d] = V[%d]; chip8->I = I; runtime->drawSprite(chip8, %d, %d, %d); V[15] = chip8->V[15];",
+                x, x, y, y, x, y, opcode & 0x000F);
+            break;
+        case 0xE000:
+            fprintf(out, kk == 0x9E ? "if (chip8->keyboard[V[%d]]) " : "if (!chip8->keyboard[V[%d]]) ", x);
+            break;
+        case 0xF000:
+            switch(kk) {
+                case 0x07: fprintf(out, "V[%d] = chip8->delayTimer;", x); break;
+                case 0x0A: fprintf(out, "for (int i = 0; i < KEYBOARD_SIZE; i++) { if (chip8->keyboard[i]) { V[%d] = i; break; } }", x); break;
+                case 0x15: fprintf(out, "chip8->delayTimer = V[%d];", x); break;
+                case 0x18: fprintf(out, "chip8->soundTimer = V[%d];", x); break;
+                case 0x1E: fprintf(out, "I += V[%d];", x); break;
+                case 0x29: fprintf(out, "I = 0x50 + V[%d] * 5;", x); break;
+                case 0x65:
+                    for (int i = 0; i <= x; i++)
+                        fprintf(out, "V[%d] = chip8->memory[I + %d]; ", i, i);
+                    break;
+            }
+            break;
+    }
+
+    // skips jump over the next instruction when their condition holds, then carry on like everything else
+    switch(opcode & 0xF000) {
+        case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xE000:
+            emitJump(out, analysis, address + 4);
+            break;
+    }
+    fprintf(out, "\n");
+
+    if (fallsThrough && nextEmitted != address + 2) {
+        fprintf(out, "    ");
+        emitJump(out, analysis, address + 2);
+        fprintf(out, "\n");
+    }
+}
+
+void emitModule(FILE* out, const char* romPath, const unsigned char* memory, const Analysis* analysis) {
+    fprintf(out, "// generated by ./recompile from %s, do not edit\n", romPath);
+    fprintf(out, "#include \"headers/chip8.h\"\n#include \"headers/aot.h\"\n\n#include <string.h>\n\n");
+
+    fprintf(out, "static const unsigned char rom[%d] = {", analysis->romSize > 0 ? analysis->romSize : 1);
+    for (int i = 0; i < analysis->romSize; i++)
+        fprintf(out, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", memory[ROM_START + i]);
+    fprintf(out, "\n};\n\n");
+
+    fprintf(out, "static const unsigned char compiled[MEMORY_SIZE] = {");
+    int count = 0;
+    for (int address = 0; address < MEMORY_SIZE; address++)
+        if (analysis->sites[address] == SITE_COMPILED)
+            fprintf(out, "%s[0x%03X] = 1,", count++ % 8 == 0 ? "\n    " : " ", address);
+    fprintf(out, "\n};\n\n");
+
+    // leave (with pc at this instruction) when the budget is used up or the code was written over since loading
+    fprintf(out, "#define ENTER(address) \\\n"
+        "    do { \\\n"
+        "        if (budget == 0 || !enabled[address]) { \\\n"
+        "            pc = address; \\\n"
+        "            goto leave; \\\n"
+        "        } \\\n"
+        "        budget--; \\\n"
+        "    } while (0)\n\n");
+
+    fprintf(out, "static int run(CHIP8* chip8, const AotRuntime* runtime, const unsigned char* enabled, int budget) {\n");
+    fprintf(out, "    unsigned char V[NUM_REGISTERS];\n");
+    fprintf(out, "    memcpy(V, chip8->V, NUM_REGISTERS);\n");
+    fprintf(out, "    unsigned short I = chip8->I;\n");
+    fprintf(out, "    unsigned short pc = chip8->pc;\n\n");
+
+    fprintf(out, "dispatch:\n    switch(pc) {\n");
+    for (int address = 0; address < MEMORY_SIZE; address++)
+        if (analysis->sites[address] == SITE_COMPILED)
+            fprintf(out, "        case 0x%03X: goto L%03X;\n", address, address);
+    fprintf(out, "        default: goto leave;\n    }\n\n");
+
+    // instructions in address order, each followed by the next one it can fall through to
+    int previous = -1;
+    for (int address = 0; address < MEMORY_SIZE; address++) {
+        if (analysis->sites[address] == SITE_UNREACHED)
+            continue;
+        if (previous >= 0)
+            emitInstruction(out, memory, analysis, previous, address);
+        previous = address;
+    }
+    if (previous >= 0)
+        emitInstruction(out, memory, analysis, previous, -1);
+
+    fprintf(out, "\nleave:\n");
+    fprintf(out, "    memcpy(chip8->V, V, NUM_REGISTERS);\n");
+    fprintf(out, "    chip8->I = I;\n");
+    fprintf(out, "    chip8->pc = pc;\n");
+    fprintf(out, "    return budget;\n}\n\n");
+
+    fprintf(out, "const AotModule chip8AotModule = { AOT_ABI_VERSION, sizeof(CHIP8), rom, %d, compiled, run };\n", analysis->romSize);
+}
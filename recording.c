@@ -0,0 +1,139 @@
+#include "headers/chip8.h"
+#include "headers/recording.h"
+
+#include <string.h>
+
+static void writeValue(FILE* file, unsigned long value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+static unsigned long readValue(const unsigned char* in, int bytes) {
+    unsigned long value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (unsigned long)in[i] << (8 * i);
+    return value;
+}
+
+unsigned short keyboardMask(const unsigned char* keyboard) {
+    // bit k is set while key k is held
+    unsigned short mask = 0;
+    for (int i = 0; i < KEYBOARD_SIZE; i++)
+        if (keyboard[i])
+            mask |= 1 << i;
+    return mask;
+}
+
+void applyKeyboardMask(unsigned char* keyboard, unsigned short mask) {
+    for (int i = 0; i < KEYBOARD_SIZE; i++)
+        keyboard[i] = (mask >> i) & 1;
+}
+
+unsigned long long hashScreen(const unsigned long long* screen) {
+    // 64-bit FNV-1a over the rows, a byte at a time from the low end, so the hash does not depend on the host
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (int row = 0; row < SCREEN_HEIGHT; row++) {
+        for (int i = 0; i < 8; i++) {
+            hash ^= (screen[row] >> (8 * i)) & 0xFF;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+int startRecording(Recorder* recorder, const char* filename, unsigned int seed, unsigned int instructionsPerFrame) {
+    recorder->file = fopen(filename, "wb");
+    if (recorder->file == NULL) {
+        fprintf(stderr, "Error opening %s for writing\n", filename);
+        return 1;
+    }
+    fwrite(RECORDING_MAGIC, 1, 4, recorder->file);
+    writeValue(recorder->file, RECORDING_VERSION, 2);
+    writeValue(recorder->file, seed, 4);
+    writeValue(recorder->file, instructionsPerFrame, 4);
+    recorder->keys = 0;
+    recorder->run = 0;
+    return 0;
+}
+
+static void endRun(Recorder* recorder) {
+    if (recorder->run == 0)
+        return;
+    writeValue(recorder->file, recorder->keys, 2);
+    writeValue(recorder->file, recorder->run, 2);
+    recorder->run = 0;
+}
+
+void recordFrame(Recorder* recorder, const unsigned char* keyboard) {
+    // call once per emulated frame, with the keys that frame is about to run with
+    unsigned short keys = keyboardMask(keyboard);
+    if (keys != recorder->keys || recorder->run == MAX_RUN_LENGTH) {
+        endRun(recorder);
+        recorder->keys = keys;
+    }
+    recorder->run++;
+}
+
+int stopRecording(Recorder* recorder) {
+    endRun(recorder);
+    int error = fclose(recorder->file) != 0;
+    if (error)
+        fprintf(stderr, "Error writing recording\n");
+    recorder->file = NULL;
+    return error;
+}
+
+int loadRecording(Recording* recording, const char* filename) {
+    // returns 0 on success, 1 if the file cannot be read or is not a recording this version understands
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+
+    unsigned char header[RECORDING_HEADER_SIZE];
+    if (fread(header, 1, RECORDING_HEADER_SIZE, file) != RECORDING_HEADER_SIZE || memcmp(header, RECORDING_MAGIC, 4) != 0) {
+        fprintf(stderr, "Not a recording\n");
+        fclose(file);
+        return 1;
+    }
+    if (readValue(header + 4, 2) != RECORDING_VERSION) {
+        fprintf(stderr, "Unsupported recording version %lu\n", readValue(header + 4, 2));
+        fclose(file);
+        return 1;
+    }
+    recording->seed = readValue(header + 6, 4);
+    recording->instructionsPerFrame = readValue(header + 10, 4);
+
+    // expand the runs into one mask per frame, growing the array as needed
+    unsigned long capacity = 0;
+    recording->frames = NULL;
+    recording->numFrames = 0;
+    unsigned char run[4];
+    while (fread(run, 1, 4, file) == 4) {
+        unsigned short keys = readValue(run, 2);
+        unsigned long length = readValue(run + 2, 2);
+        if (recording->numFrames + length > capacity) {
+            capacity = (recording->numFrames + length) * 2;
+            unsigned short* frames = realloc(recording->frames, capacity * sizeof(unsigned short));
+            if (frames == NULL) {
+                fprintf(stderr, "Error allocating recording\n");
+                freeRecording(recording);
+                fclose(file);
+                return 1;
+            }
+            recording->frames = frames;
+        }
+        for (unsigned long i = 0; i < length; i++)
+            recording->frames[recording->numFrames++] = keys;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void freeRecording(Recording* recording) {
+    free(recording->frames);
+    recording->frames = NULL;
+    recording->numFrames = 0;
+}
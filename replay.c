@@ -0,0 +1,150 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/recording.h"
+#include "headers/replay.h"
+
+/*
+    - replays a recording made with ./main --record as fast as the engine can go: same seed, same instructions
+      per frame, and each frame runs with the keys that were held during it
+    - the screen is hashed after every frame; a golden file is those hashes, one per line in hex
+    - -w writes the golden file, -g compares against it and exits with 1 at the first frame that differs
+*/
+
+int main(int argc, char *argv[]) {
+    EngineType engineType = ENGINE_INTERPRETER;
+    const char* goldenPath = NULL;
+    int writing = 0;
+    int skipIdle = 0;
+
+    // parse the options, then the ROM and its recording
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-i") == 0) {
+            skipIdle = 1;
+            arg++;
+            continue;
+        }
+        if (strcmp(argv[arg], "-e") == 0) {
+            if (!parseEngineType(argv[arg+1], &engineType)) {
+                fprintf(stderr, "Unknown engine %s\n", argv[arg+1]);
+                exit(1);
+            }
+        } else if (strcmp(argv[arg], "-g") == 0 || strcmp(argv[arg], "-w") == 0) {
+            goldenPath = argv[arg+1];
+            writing = argv[arg][1] == 'w';
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: ./replay [-e ENGINE] [-i] [-g GOLDEN | -w GOLDEN] [ROM PATH] [RECORDING PATH]\n");
+        exit(1);
+    }
+
+    Recording recording;
+    if (loadRecording(&recording, argv[arg+1]))
+        exit(1);
+
+    CHIP8 chip8;
+    initializeEmulator(&chip8);
+    if (loadROM(&chip8, argv[arg]))
+        exit(1);
+    seedRandom(&chip8, recording.seed);
+
+    Engine engine;
+    if (createEngine(&engine, engineType))
+        exit(1);
+    if (engineType == ENGINE_AOT && loadAotModule(engine.aot, argv[arg]))
+        exit(1);
+    engine.idle.enabled = skipIdle;
+
+    unsigned long long* hashes = malloc((recording.numFrames + 1) * sizeof(unsigned long long));
+    if (hashes == NULL) {
+        fprintf(stderr, "Error allocating %lu frame hashes\n", recording.numFrames);
+        exit(1);
+    }
+
+    unsigned long long start = monotonicNanoseconds();
+    replayRecording(&engine, &chip8, &recording, hashes);
+    double seconds = (monotonicNanoseconds() - start) / 1e9;
+    printf("%s: %lu frames (%.1f s of play) replayed in %.3f ms\n",
+        argv[arg], recording.numFrames, (double)recording.numFrames / TIMER_HZ, seconds * 1e3);
+    if (skipIdle)
+        printf("idle loops: %.1f%% of instructions skipped\n",
+            100.0 * engine.idle.skipped / ((double)recording.numFrames * recording.instructionsPerFrame));
+
+    int result = 0;
+    if (goldenPath != NULL && writing)
+        result = writeGolden(goldenPath, hashes, recording.numFrames);
+    else if (goldenPath != NULL)
+        result = checkGolden(goldenPath, hashes, recording.numFrames);
+
+    free(hashes);
+    freeRecording(&recording);
+    destroyEngine(&engine);
+    return result;
+}
+
+void replayRecording(Engine* engine, CHIP8* chip8, const Recording* recording, unsigned long long* hashes) {
+    // hashes gets one entry per frame
+    for (unsigned long frame = 0; frame < recording->numFrames; frame++) {
+        applyKeyboardMask(chip8->keyboard, recording->frames[frame]);
+        runFrame(engine, chip8, recording->instructionsPerFrame);
+        hashes[frame] = hashScreen(chip8->screen);
+    }
+}
+
+int writeGolden(const char* filename, const unsigned long long* hashes, unsigned long numFrames) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s for writing\n", filename);
+        return 1;
+    }
+    for (unsigned long frame = 0; frame < numFrames; frame++)
+        fprintf(file, "%016llx\n", hashes[frame]);
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Error writing %s\n", filename);
+        return 1;
+    }
+    printf("Wrote %s\n", filename);
+    return 0;
+}
+
+int checkGolden(const char* filename, const unsigned long long* hashes, unsigned long numFrames) {
+    // returns 0 if every frame matches and the golden file has exactly as many frames as the replay
+    FILE* file = fopen(filename, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+
+    unsigned long long expected;
+    unsigned long frame = 0;
+    int result = 0;
+    while (fscanf(file, "%llx", &expected) == 1) {
+        if (frame >= numFrames) {
+            fprintf(stderr, "FAIL: golden file has more frames than the recording (%lu)\n", numFrames);
+            result = 1;
+            break;
+        }
+        if (hashes[frame] != expected) {
+            fprintf(stderr, "FAIL: frame %lu differs (screen %016llx, golden %016llx)\n", frame, hashes[frame], expected);
+            result = 1;
+            break;
+        }
+        frame++;
+    }
+    if (result == 0 && frame < numFrames) {
+        fprintf(stderr, "FAIL: golden file ends at frame %lu of %lu\n", frame, numFrames);
+        result = 1;
+    }
+    fclose(file);
+
+    if (result == 0)
+        printf("OK: all %lu frames match %s\n", numFrames, filename);
+    return result;
+}
@@ -0,0 +1,116 @@
+#include "headers/chip8.h"
+#include "headers/delta.h"
+#include "headers/rewind.h"
+
+#include <string.h>
+
+/*
+    - every frame the serialized state goes into a ring buffer. Once per KEYFRAME_INTERVAL frames it is stored whole;
+      the frames in between store only an XOR/RLE delta against that keyframe (usually a few dozen bytes instead of ~4.4 KB)
+    - rewinding pops the newest frame and rebuilds it from its keyframe, so going back never costs more than one decode
+    - when the ring is full the oldest frame is dropped. If that was a keyframe it is copied aside (there is only ever
+      one: every delta against the one before is older still) and the deltas against it are pointed at the copy, so
+      exactly one frame is lost however small the ring is
+*/
+
+int createRewindBuffer(RewindBuffer* rewind, int frames) {
+    if (frames < 0) {
+        fprintf(stderr, "Rewind buffer cannot hold %d frames\n", frames);
+        return 1;
+    }
+    rewind->entries = calloc(frames, sizeof(RewindEntry));
+    if (frames > 0 && rewind->entries == NULL) {
+        fprintf(stderr, "Error allocating the rewind buffer\n");
+        return 1;
+    }
+    rewind->capacity = frames;
+    rewind->start = 0;
+    rewind->count = 0;
+    return 0;
+}
+
+void destroyRewindBuffer(RewindBuffer* rewind) {
+    for (int i = 0; i < rewind->capacity; i++)
+        free(rewind->entries[i].data);
+    free(rewind->entries);
+    rewind->entries = NULL;
+    rewind->count = 0;
+}
+
+static void dropOldest(RewindBuffer* rewind) {
+    int oldest = rewind->start;
+    rewind->start = (rewind->start + 1) % rewind->capacity;
+    rewind->count--;
+    if (rewind->entries[oldest].keyframe != oldest)
+        return;
+
+    // keep the keyframe for the deltas that follow it (they come straight after it, up to the next keyframe)
+    memcpy(rewind->retired, rewind->entries[oldest].data, STATE_SIZE);
+    for (int i = 0; i < rewind->count; i++) {
+        RewindEntry* entry = &rewind->entries[(rewind->start + i) % rewind->capacity];
+        if (entry->keyframe != oldest)
+            break;
+        entry->keyframe = RETIRED_KEYFRAME;
+    }
+}
+
+static const unsigned char* keyframeData(const RewindBuffer* rewind, int keyframe) {
+    return keyframe == RETIRED_KEYFRAME ? rewind->retired : rewind->entries[keyframe].data;
+}
+
+int captureFrame(RewindBuffer* rewind, const CHIP8* chip8) {
+    if (rewind->capacity == 0)
+        return 0;
+    if (rewind->count == rewind->capacity)
+        dropOldest(rewind);
+
+    // a keyframe if there is nothing to be a delta against, or the last keyframe is old enough (or already dropped)
+    int newest = (rewind->start + rewind->count - 1 + rewind->capacity) % rewind->capacity;
+    int index = (rewind->start + rewind->count) % rewind->capacity;
+    int keyframe = index;
+    if (rewind->count > 0 && rewind->entries[newest].keyframe != RETIRED_KEYFRAME) {
+        int last = rewind->entries[newest].keyframe;
+        if ((index - last + rewind->capacity) % rewind->capacity < KEYFRAME_INTERVAL)
+            keyframe = last;
+    }
+
+    RewindEntry* entry = &rewind->entries[index];
+    int needed = keyframe == index ? STATE_SIZE : DELTA_MAX_SIZE(STATE_SIZE);
+    if (entry->capacity < needed) {
+        unsigned char* data = realloc(entry->data, needed);
+        if (data == NULL) {
+            fprintf(stderr, "Error allocating a rewind frame\n");
+            return 1;
+        }
+        entry->data = data;
+        entry->capacity = needed;
+    }
+
+    serializeState(chip8, rewind->state);
+    if (keyframe == index) {
+        memcpy(entry->data, rewind->state, STATE_SIZE);
+        entry->length = STATE_SIZE;
+    } else {
+        entry->length = encodeDelta(keyframeData(rewind, keyframe), rewind->state, STATE_SIZE, entry->data);
+    }
+    entry->keyframe = keyframe;
+    rewind->count++;
+    return 0;
+}
+
+int rewindFrame(RewindBuffer* rewind, CHIP8* chip8) {
+    // restores the newest captured frame and forgets it. Returns 0 when there is nothing left to go back to
+    if (rewind->count == 0)
+        return 0;
+
+    int newest = (rewind->start + rewind->count - 1) % rewind->capacity;
+    RewindEntry* entry = &rewind->entries[newest];
+    rewind->count--;
+
+    if (entry->keyframe == newest)
+        return deserializeState(chip8, entry->data) == 0;
+
+    if (decodeDelta(keyframeData(rewind, entry->keyframe), entry->data, entry->length, rewind->state, STATE_SIZE))
+        return 0;
+    return deserializeState(chip8, rewind->state) == 0;
+}
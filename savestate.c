@@ -0,0 +1,126 @@
+#include "headers/chip8.h"
+#include "headers/savestate.h"
+
+#include <string.h>
+
+/*
+    - a save state is the whole machine in a fixed layout: every multi-byte field is little endian,
+      so the files do not depend on the struct layout or the host
+    - the header carries a version; anything with a different version is rejected instead of being misread
+*/
+
+static unsigned char* put(unsigned char* out, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        *out++ = (value >> (8 * i)) & 0xFF;
+    return out;
+}
+
+static const unsigned char* get(const unsigned char* in, unsigned long long* value, int bytes) {
+    *value = 0;
+    for (int i = 0; i < bytes; i++)
+        *value |= (unsigned long long)*in++ << (8 * i);
+    return in;
+}
+
+int serializeState(const CHIP8* chip8, unsigned char* out) {
+    // out must have room for STATE_SIZE bytes. Returns the number of bytes written
+    unsigned char* p = out;
+    memcpy(p, STATE_MAGIC, 4);
+    p = put(p + 4, STATE_VERSION, 2);
+
+    memcpy(p, chip8->memory, MEMORY_SIZE);
+    p += MEMORY_SIZE;
+    memcpy(p, chip8->V, NUM_REGISTERS);
+    p += NUM_REGISTERS;
+    p = put(p, chip8->I, 2);
+    p = put(p, chip8->soundTimer, 1);
+    p = put(p, chip8->delayTimer, 1);
+    p = put(p, chip8->pc, 2);
+    p = put(p, chip8->sp, 1);
+    for (int i = 0; i < STACK_SIZE; i++)
+        p = put(p, chip8->stack[i], 2);
+    memcpy(p, chip8->keyboard, KEYBOARD_SIZE);
+    p += KEYBOARD_SIZE;
+    for (int row = 0; row < SCREEN_HEIGHT; row++)
+        p = put(p, chip8->screen[row], 8);
+    p = put(p, chip8->rngState, 4);
+
+    return p - out;
+}
+
+int deserializeState(CHIP8* chip8, const unsigned char* in) {
+    // returns 0 on success, 1 if in is not a state this version understands (chip8 is left untouched)
+    unsigned long long value;
+    if (memcmp(in, STATE_MAGIC, 4) != 0) {
+        fprintf(stderr, "Not a save state\n");
+        return 1;
+    }
+    const unsigned char* p = get(in + 4, &value, 2);
+    if (value != STATE_VERSION) {
+        fprintf(stderr, "Unsupported save state version %llu\n", value);
+        return 1;
+    }
+
+    memcpy(chip8->memory, p, MEMORY_SIZE);
+    p += MEMORY_SIZE;
+    memcpy(chip8->V, p, NUM_REGISTERS);
+    p += NUM_REGISTERS;
+    p = get(p, &value, 2);
+    chip8->I = value;
+    p = get(p, &value, 1);
+    chip8->soundTimer = value;
+    p = get(p, &value, 1);
+    chip8->delayTimer = value;
+    p = get(p, &value, 2);
+    chip8->pc = value;
+    p = get(p, &value, 1);
+    chip8->sp = value;
+    for (int i = 0; i < STACK_SIZE; i++) {
+        p = get(p, &value, 2);
+        chip8->stack[i] = value;
+    }
+    memcpy(chip8->keyboard, p, KEYBOARD_SIZE);
+    p += KEYBOARD_SIZE;
+    for (int row = 0; row < SCREEN_HEIGHT; row++)
+        p = get(p, &chip8->screen[row], 8);
+    p = get(p, &value, 4);
+    chip8->rngState = value;
+
+    chip8->drawFlag = 1;
+    return 0;
+}
+
+int saveState(const CHIP8* chip8, const char* filename) {
+    unsigned char buffer[STATE_SIZE];
+    int size = serializeState(chip8, buffer);
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+    size_t bytesWritten = fwrite(buffer, 1, size, file);
+    fclose(file);
+    if (bytesWritten != (size_t)size) {
+        fprintf(stderr, "Error writing %s\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+int loadState(CHIP8* chip8, const char* filename) {
+    unsigned char buffer[STATE_SIZE];
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+    size_t bytesRead = fread(buffer, 1, STATE_SIZE, file);
+    fclose(file);
+    if (bytesRead != STATE_SIZE) {
+        fprintf(stderr, "Error reading %s\n", filename);
+        return 1;
+    }
+    return deserializeState(chip8, buffer);
+}
@@ -0,0 +1,66 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+
+unsigned long long monotonicNanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+void initializeScheduler(Scheduler* scheduler, unsigned int instructionsPerFrame, int turbo) {
+    scheduler->instructionsPerFrame = instructionsPerFrame;
+    scheduler->turbo = turbo;
+    scheduler->lastTime = monotonicNanoseconds();
+    scheduler->accumulator = 0;
+}
+
+int framesDue(Scheduler* scheduler) {
+    // in turbo mode there is no wall clock to keep up with: always run the next frame straight away
+    if (scheduler->turbo)
+        return 1;
+
+    // add the time since the last call to the accumulator and take as many whole frames out of it as fit
+    // (working in ns * TIMER_HZ keeps the frame length exact, so the timers never drift from 60Hz)
+    unsigned long long now = monotonicNanoseconds();
+    scheduler->accumulator += (now - scheduler->lastTime) * TIMER_HZ;
+    scheduler->lastTime = now;
+
+    int frames = scheduler->accumulator / NANOSECONDS_PER_SECOND;
+    scheduler->accumulator %= NANOSECONDS_PER_SECOND;
+
+    if (frames > MAX_CATCHUP_FRAMES)
+        frames = MAX_CATCHUP_FRAMES;
+    return frames;
+}
+
+unsigned long long nanosecondsUntilNextFrame(Scheduler* scheduler) {
+    if (scheduler->turbo)
+        return 0;
+
+    // whatever is left of the current frame
+    unsigned long long elapsed = (monotonicNanoseconds() - scheduler->lastTime) * TIMER_HZ + scheduler->accumulator;
+    if (elapsed >= NANOSECONDS_PER_SECOND)
+        return 0;
+    return (NANOSECONDS_PER_SECOND - elapsed) / TIMER_HZ;
+}
+
+unsigned int millisecondsUntilNextFrame(Scheduler* scheduler) {
+    // rounded up. Oversleeping is harmless: framesDue picks up the extra time next call
+    return (nanosecondsUntilNextFrame(scheduler) + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND;
+}
+
+void runFrame(Engine* engine, CHIP8* chip8, unsigned int instructionsPerFrame) {
+    // a frame is a fixed number of instructions followed by one 60Hz timer tick
+    // (when the frame starts in an idle loop, most of it can be skipped, see idle.h)
+    unsigned long done = engine->idle.enabled ? skipIdleLoop(&engine->idle, chip8, instructionsPerFrame) : 0;
+    runInstructions(engine, chip8, instructionsPerFrame - done);
+    updateTimers(chip8);
+}
+
+void runCycles(Engine* engine, CHIP8* chip8, unsigned long cycles, unsigned int instructionsPerFrame) {
+    // run whole frames first, then whatever is left over (the timers only tick at the end of a whole frame)
+    for (unsigned long frame = 0; frame < cycles / instructionsPerFrame; frame++)
+        runFrame(engine, chip8, instructionsPerFrame);
+    runInstructions(engine, chip8, cycles % instructionsPerFrame);
+}
@@ -0,0 +1,71 @@
+#include "headers/chip8.h"
+#include "headers/screen.h"
+
+/*
+    - the core keeps the display as one 64-bit word per row; SDL wants one 32-bit RGBA pixel per pixel
+    - expanding is done only when a frame is presented. With AVX2 one byte of the row becomes 8 pixels
+      (broadcast it, AND with a different bit per lane, compare) so a row is 8 stores; SSE2 does 4 pixels at a time
+    - the AVX2 path is picked at runtime, so the binary does not have to be built with -mavx2
+*/
+
+#if defined(__x86_64__) // SSE2 is always there on x86-64
+#define SCREEN_X86
+#include <immintrin.h>
+#endif
+
+#ifdef SCREEN_X86
+
+static void expandRowsSSE2(const unsigned long long* screen, unsigned int* pixels, int pitch, int firstRow, int numRows) {
+    const __m128i bits = _mm_set_epi32(1, 2, 4, 8); // lane 0 is the leftmost pixel of the nibble
+    for (int row = firstRow; row < firstRow + numRows; row++) {
+        unsigned int* out = pixels + (row - firstRow) * pitch;
+        for (int nibble = 0; nibble < SCREEN_WIDTH / 4; nibble++) {
+            __m128i value = _mm_set1_epi32((screen[row] >> (60 - 4 * nibble)) & 0xF);
+            _mm_storeu_si128((__m128i*)(out + 4 * nibble), _mm_cmpeq_epi32(_mm_and_si128(value, bits), bits));
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void expandRowsAVX2(const unsigned long long* screen, unsigned int* pixels, int pitch, int firstRow, int numRows) {
+    const __m256i bits = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128); // lane 0 is the leftmost pixel of the byte
+    for (int row = firstRow; row < firstRow + numRows; row++) {
+        unsigned int* out = pixels + (row - firstRow) * pitch;
+        for (int byte = 0; byte < SCREEN_WIDTH / 8; byte++) {
+            __m256i value = _mm256_set1_epi32((screen[row] >> (56 - 8 * byte)) & 0xFF);
+            _mm256_storeu_si256((__m256i*)(out + 8 * byte), _mm256_cmpeq_epi32(_mm256_and_si256(value, bits), bits));
+        }
+    }
+}
+
+#else
+
+static void expandRowsScalar(const unsigned long long* screen, unsigned int* pixels, int pitch, int firstRow, int numRows) {
+    for (int row = firstRow; row < firstRow + numRows; row++) {
+        unsigned int* out = pixels + (row - firstRow) * pitch;
+        for (int col = 0; col < SCREEN_WIDTH; col++)
+            out[col] = (screen[row] >> (63 - col)) & 1 ? PIXEL_ON : PIXEL_OFF;
+    }
+}
+
+#endif
+
+void expandRows(const unsigned long long* screen, unsigned int* pixels, int pitch, int firstRow, int numRows) {
+    // pixels points at firstRow's output, pitch is in pixels
+#ifdef SCREEN_X86
+    static int hasAVX2 = -1;
+    if (hasAVX2 < 0)
+        hasAVX2 = __builtin_cpu_supports("avx2");
+
+    if (hasAVX2)
+        expandRowsAVX2(screen, pixels, pitch, firstRow, numRows);
+    else
+        expandRowsSSE2(screen, pixels, pitch, firstRow, numRows);
+#else
+    expandRowsScalar(screen, pixels, pitch, firstRow, numRows);
+#endif
+}
+
+void expandScreen(const unsigned long long* screen, unsigned int* pixels) {
+    expandRows(screen, pixels, SCREEN_WIDTH, 0, SCREEN_HEIGHT);
+}
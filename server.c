@@ -0,0 +1,366 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/recording.h"
+#include "headers/stream.h"
+#include "headers/server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+    - runs one instance per ROM at 60Hz without a window and streams their screens to clients on a Unix domain
+      socket (see stream.h for the protocol); clients send the keys back, so a viewer can play any instance
+    - each frame that draws is encoded once, as a delta against the screen before it, and that one buffer is written
+      to every client watching the instance. A frame that draws nothing costs nothing, not even the delta
+    - the socket is non-blocking: a client that cannot keep up misses frames and then gets a single delta from the
+      screen it has to the current one, so a slow viewer never holds up the emulation or the other viewers
+*/
+
+static volatile sig_atomic_t quit = 0;
+
+static void stop(int signal) {
+    (void)signal;
+    quit = 1;
+}
+
+int main(int argc, char *argv[]) {
+    EngineType engineType = ENGINE_PREDECODE;
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    unsigned int seed = DEFAULT_SEED;
+    const char* socketPath = DEFAULT_SOCKET_PATH;
+
+    // parse the options, everything after them is a ROM path
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-e") == 0) {
+            if (!parseEngineType(argv[arg+1], &engineType)) {
+                fprintf(stderr, "Unknown engine %s\n", argv[arg+1]);
+                exit(1);
+            }
+        } else if (strcmp(argv[arg], "-r") == 0 && atoi(argv[arg+1]) > 0) {
+            instructionsPerFrame = atoi(argv[arg+1]);
+        } else if (strcmp(argv[arg], "-s") == 0) {
+            seed = strtoul(argv[arg+1], NULL, 10);
+        } else if (strcmp(argv[arg], "-p") == 0) {
+            socketPath = argv[arg+1];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    int numInstances = argc - arg;
+    if (numInstances < 1 || numInstances > MAX_INSTANCES) {
+        fprintf(stderr, "Usage: ./server [-e ENGINE] [-r INSTRUCTIONS PER FRAME] [-s SEED] [-p SOCKET PATH] [ROM PATH]... (up to %d ROMs)\n", MAX_INSTANCES);
+        exit(1);
+    }
+
+    static Server server;
+    server.instances = malloc(numInstances * sizeof(Instance));
+    if (server.instances == NULL) {
+        fprintf(stderr, "Error allocating %d instances\n", numInstances);
+        exit(1);
+    }
+    server.numInstances = numInstances;
+    server.instructionsPerFrame = instructionsPerFrame;
+    server.frames = 0;
+    server.bytesSent = 0;
+
+    for (int i = 0; i < numInstances; i++) {
+        Instance* instance = &server.instances[i];
+        initializeEmulator(&instance->chip8);
+        if (loadROM(&instance->chip8, argv[arg + i]))
+            exit(1);
+        seedRandom(&instance->chip8, seed + i);
+        if (createEngine(&instance->engine, engineType))
+            exit(1);
+        if (engineType == ENGINE_AOT && loadAotModule(instance->engine.aot, argv[arg + i]))
+            exit(1);
+        instance->engine.idle.enabled = 1; // most of what a server runs is waiting for a key nobody presses
+        instance->keys = 0;
+        memset(instance->previous, 0, sizeof(instance->previous));
+        instance->frame = 0;
+        instance->messageLength = 0;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        server.clients[i].fd = -1;
+
+    server.listener = openListener(socketPath);
+    if (server.listener < 0)
+        exit(1);
+
+    // a viewer closing its end mid-write is an error from write, not a reason to die
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    printf("Serving %d instance(s) on %s\n", numInstances, socketPath);
+
+    Scheduler scheduler;
+    initializeScheduler(&scheduler, instructionsPerFrame, 0);
+
+    while (!quit) {
+        int frames = framesDue(&scheduler);
+        for (int frame = 0; frame < frames; frame++)
+            runServerFrame(&server);
+
+        // sleep until the next frame is due or a client needs something, whichever comes first
+        struct pollfd fds[MAX_CLIENTS + 1];
+        Client* polled[MAX_CLIENTS + 1];
+        int numFds = 0;
+        fds[numFds].fd = server.listener;
+        fds[numFds].events = POLLIN;
+        polled[numFds++] = NULL;
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            Client* client = &server.clients[i];
+            if (client->fd < 0)
+                continue;
+            fds[numFds].fd = client->fd;
+            fds[numFds].events = POLLIN | (client->pendingStart < client->pendingLength ? POLLOUT : 0);
+            polled[numFds++] = client;
+        }
+
+        if (poll(fds, numFds, millisecondsUntilNextFrame(&scheduler)) <= 0)
+            continue; // timed out, or interrupted by a signal
+
+        for (int i = 1; i < numFds; i++) {
+            Client* client = polled[i];
+            if (fds[i].revents & POLLOUT && flushClient(client)) {
+                closeClient(&server, client);
+                continue;
+            }
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                readClient(&server, client);
+        }
+        if (fds[0].revents & POLLIN)
+            acceptClient(&server);
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (server.clients[i].fd >= 0)
+            closeClient(&server, &server.clients[i]);
+    close(server.listener);
+    unlink(socketPath);
+
+    printf("%llu frames, %llu bytes sent (%.1f bytes per frame per instance)\n", server.frames, server.bytesSent,
+        server.frames ? (double)server.bytesSent / server.frames / numInstances : 0.0);
+    for (int i = 0; i < numInstances; i++)
+        destroyEngine(&server.instances[i].engine);
+    free(server.instances);
+    return 0;
+}
+
+int openListener(const char* path) {
+    // returns the listening socket, or -1
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        fprintf(stderr, "Error creating socket\n");
+        return -1;
+    }
+    unlink(path); // left over from a server that did not exit cleanly
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listener, LISTEN_BACKLOG) != 0) {
+        fprintf(stderr, "Error listening on %s\n", path);
+        close(listener);
+        return -1;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    return listener;
+}
+
+void acceptClient(Server* server) {
+    int fd = accept(server->listener, NULL, NULL);
+    if (fd < 0)
+        return;
+
+    Client* client = NULL;
+    for (int i = 0; i < MAX_CLIENTS && client == NULL; i++)
+        if (server->clients[i].fd < 0)
+            client = &server->clients[i];
+    if (client == NULL) {
+        fprintf(stderr, "Too many clients, refusing one\n");
+        close(fd);
+        return;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    client->fd = fd;
+    client->instance = -1;
+    client->keysInstance = -1;
+    client->keys = 0;
+    client->synced = 0;
+    client->pendingStart = 0;
+    client->pendingLength = 0;
+    client->bytesSent = 0;
+    initializeReader(&client->reader);
+
+    unsigned char info[MESSAGE_HEADER_SIZE + 4];
+    packHeader(info, MESSAGE_INFO, 0, 4);
+    put16(info + MESSAGE_HEADER_SIZE, server->numInstances);
+    put16(info + MESSAGE_HEADER_SIZE + 2, server->instructionsPerFrame);
+    if (sendToClient(client, info, sizeof(info)))
+        closeClient(server, client);
+}
+
+void closeClient(Server* server, Client* client) {
+    server->bytesSent += client->bytesSent;
+    close(client->fd);
+    client->fd = -1;
+
+    // let go of whatever keys it was holding, or the game sees them held forever
+    if (client->keysInstance >= 0)
+        updateKeys(server, client->keysInstance);
+}
+
+void readClient(Server* server, Client* client) {
+    if (!receiveMessages(&client->reader, client->fd)) {
+        closeClient(server, client);
+        return;
+    }
+
+    Message message;
+    while (nextMessage(&client->reader, &message)) {
+        if (message.instance >= server->numInstances) {
+            fprintf(stderr, "Client asked for instance %d of %d, disconnecting it\n", message.instance, server->numInstances);
+            closeClient(server, client);
+            return;
+        }
+
+        if (message.type == MESSAGE_SUBSCRIBE) {
+            // the client starts over from a blank screen, the next frame brings it up to date
+            client->instance = message.instance;
+            client->synced = 0;
+            memset(client->base, 0, sizeof(client->base));
+        } else if (message.type == MESSAGE_KEYS && message.length >= 2) {
+            int previous = client->keysInstance;
+            client->keysInstance = message.instance;
+            client->keys = get16(message.payload);
+            if (previous >= 0 && previous != message.instance)
+                updateKeys(server, previous);
+            updateKeys(server, message.instance);
+        } else {
+            fprintf(stderr, "Unexpected message %d from a client, disconnecting it\n", message.type);
+            closeClient(server, client);
+            return;
+        }
+    }
+}
+
+void updateKeys(Server* server, int instance) {
+    // an instance runs with the keys of every connected client playing it
+    unsigned short keys = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        if (server->clients[i].fd >= 0 && server->clients[i].keysInstance == instance)
+            keys |= server->clients[i].keys;
+    server->instances[instance].keys = keys;
+}
+
+void runServerFrame(Server* server) {
+    // run a frame of every instance and encode what it drew, once
+    for (int i = 0; i < server->numInstances; i++) {
+        Instance* instance = &server->instances[i];
+        applyKeyboardMask(instance->chip8.keyboard, instance->keys);
+        runFrame(&instance->engine, &instance->chip8, server->instructionsPerFrame);
+        instance->frame++;
+
+        instance->messageLength = 0;
+        if (!instance->chip8.drawFlag) // nothing drawn, nothing to send (the delta would be empty anyway)
+            continue;
+        instance->chip8.drawFlag = 0;
+
+        unsigned char* payload = instance->message + MESSAGE_HEADER_SIZE;
+        int length = encodeDelta((const unsigned char*)instance->previous, (const unsigned char*)instance->chip8.screen,
+            SCREEN_BYTES, payload + FRAME_HEADER_SIZE);
+        if (length == 0) // drew and erased the same sprite
+            continue;
+        put32(payload, instance->frame);
+        packHeader(instance->message, MESSAGE_FRAME, i, FRAME_HEADER_SIZE + length);
+        instance->messageLength = MESSAGE_HEADER_SIZE + FRAME_HEADER_SIZE + length;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        Client* client = &server->clients[i];
+        if (client->fd >= 0 && client->instance >= 0 && sendFrame(&server->instances[client->instance], client))
+            closeClient(server, client);
+    }
+
+    // only now, sendFrame needs the screen each client had
+    for (int i = 0; i < server->numInstances; i++)
+        if (server->instances[i].messageLength > 0)
+            memcpy(server->instances[i].previous, server->instances[i].chip8.screen, sizeof(server->instances[i].previous));
+    server->frames++;
+}
+
+int sendFrame(Instance* instance, Client* client) {
+    // returns 1 if the client has gone
+    if (flushClient(client))
+        return 1;
+
+    // still busy with an older frame: skip this one, and catch up with a single delta once the socket has room again
+    if (client->pendingStart < client->pendingLength) {
+        if (client->synced)
+            memcpy(client->base, instance->previous, sizeof(client->base));
+        client->synced = 0;
+        return 0;
+    }
+
+    // the common case: the client is up to date, so the delta everyone else gets is the one it needs
+    if (client->synced)
+        return instance->messageLength > 0 ? sendToClient(client, instance->message, instance->messageLength) : 0;
+
+    unsigned char message[MAX_MESSAGE_SIZE];
+    unsigned char* payload = message + MESSAGE_HEADER_SIZE;
+    int length = encodeDelta((const unsigned char*)client->base, (const unsigned char*)instance->chip8.screen,
+        SCREEN_BYTES, payload + FRAME_HEADER_SIZE);
+    client->synced = 1;
+    if (length == 0)
+        return 0;
+    put32(payload, instance->frame);
+    packHeader(message, MESSAGE_FRAME, client->instance, FRAME_HEADER_SIZE + length);
+    return sendToClient(client, message, MESSAGE_HEADER_SIZE + FRAME_HEADER_SIZE + length);
+}
+
+int sendToClient(Client* client, const unsigned char* data, int length) {
+    // writes straight from the caller's buffer, only what the socket has no room for is copied (to pending).
+    // Must only be called with nothing pending. Returns 1 if the client has gone
+    ssize_t written = write(client->fd, data, length);
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return 1;
+        written = 0;
+    }
+    client->bytesSent += written;
+
+    memcpy(client->pending, data + written, length - written);
+    client->pendingStart = 0;
+    client->pendingLength = length - written;
+    return 0;
+}
+
+int flushClient(Client* client) {
+    // writes as much of pending as the socket takes. Returns 1 if the client has gone
+    if (client->pendingStart == client->pendingLength)
+        return 0;
+
+    ssize_t written = write(client->fd, client->pending + client->pendingStart, client->pendingLength - client->pendingStart);
+    if (written < 0)
+        return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+    client->bytesSent += written;
+    client->pendingStart += written;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/snapshot.h"
+#include "headers/snapcheck.h"
+
+/*
+    - checks that a snapshot step that runs out of pages leaves the searcher usable: every ROM is stepped along one
+      path by two searchers, one of which may not allocate a single page more than it already holds, until a step
+      writes to memory and fails. Restoring the same snapshot must then bring back its memory exactly, and the next
+      step (with pages to spare) must end where the other searcher's does
+    - a ROM that never writes to memory within SNAPCHECK_STEPS steps is skipped; make verify runs it on every ROM
+*/
+
+int main(int argc, char *argv[]) {
+    EngineType engineType = ENGINE_INTERPRETER;
+
+    // parse the options, everything after them is a ROM path
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-e") == 0 && parseEngineType(argv[arg+1], &engineType)) {
+            arg += 2;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+    }
+
+    if (arg == argc) {
+        fprintf(stderr, "Usage: ./snapcheck [-e ENGINE] [ROM PATH]...\n");
+        exit(1);
+    }
+
+    int checked = 0;
+    for (; arg < argc; arg++) {
+        CHIP8 root;
+        initializeEmulator(&root);
+        if (loadROM(&root, argv[arg]))
+            exit(1);
+        seedRandom(&root, DEFAULT_SEED);
+
+        int result = checkOutOfMemory(&root, engineType);
+        if (result < 0) {
+            printf("%s: never writes to memory, skipped\n", argv[arg]);
+            continue;
+        }
+        if (result > 0) {
+            fprintf(stderr, "FAIL: %s\n", argv[arg]);
+            exit(1);
+        }
+        printf("OK: %s recovers from a failed step\n", argv[arg]);
+        checked++;
+    }
+
+    if (checked == 0) {
+        fprintf(stderr, "FAIL: no ROM wrote to memory, nothing was checked\n");
+        exit(1);
+    }
+    return 0;
+}
+
+int checkOutOfMemory(const CHIP8* root, EngineType type) {
+    // returns 0 if the searcher came through a failed step intact, 1 if not, -1 if no step ever failed
+    static Searcher limited, reference;
+    if (createSearcher(&limited, root, type, DEFAULT_INSTRUCTIONS_PER_FRAME) ||
+        createSearcher(&reference, root, type, DEFAULT_INSTRUCTIONS_PER_FRAME))
+        exit(1);
+
+    Snapshot current, expected;
+    if (captureSnapshot(&limited, &current) || captureSnapshot(&reference, &expected))
+        exit(1);
+
+    int result = -1;
+    for (int step = 0; step < SNAPCHECK_STEPS && result < 0; step++) {
+        unsigned short keys = step % 3 == 0 ? 0 : 1 << (step % KEYBOARD_SIZE);
+
+        // not one page more than it holds, so the first step that writes to memory fails
+        Snapshot next;
+        cloneSnapshot(&next, &current);
+        limited.pool.maxPages = limited.pool.pagesInUse;
+        int failed = stepSnapshot(&limited, &next, keys, SNAPCHECK_FRAMES);
+        limited.pool.maxPages = 0;
+
+        if (!failed) {
+            releaseSnapshot(&limited, &current);
+            current = next;
+            if (stepSnapshot(&reference, &expected, keys, SNAPCHECK_FRAMES))
+                exit(1);
+            continue;
+        }
+        releaseSnapshot(&limited, &next);
+
+        restoreSnapshot(&limited, &current);
+        if (!holdsSnapshot(&limited, &current)) {
+            fprintf(stderr, "Restoring after a failed step left stale memory at step %d\n", step);
+            result = 1;
+            break;
+        }
+
+        // a different step from the same place, so nothing left over from the failed one can go unnoticed
+        keys ^= 0xFFFF;
+        if (stepSnapshot(&limited, &current, keys, SNAPCHECK_FRAMES) ||
+            stepSnapshot(&reference, &expected, keys, SNAPCHECK_FRAMES))
+            exit(1);
+        if (!sameSnapshot(&current, &expected)) {
+            fprintf(stderr, "The step after a failed one went somewhere else at step %d\n", step);
+            result = 1;
+            break;
+        }
+        result = 0;
+    }
+
+    releaseSnapshot(&limited, &current);
+    releaseSnapshot(&reference, &expected);
+    destroySearcher(&limited);
+    destroySearcher(&reference);
+    return result;
+}
+
+int sameSnapshot(const Snapshot* a, const Snapshot* b) {
+    if (memcmp(a->state, b->state, MACHINE_STATE_SIZE) != 0)
+        return 0;
+    for (int i = 0; i < NUM_PAGES; i++)
+        if (memcmp(a->pages[i]->data, b->pages[i]->data, PAGE_SIZE) != 0)
+            return 0;
+    return 1;
+}
+
+int holdsSnapshot(const Searcher* searcher, const Snapshot* snapshot) {
+    // the working machine is exactly snapshot
+    if (memcmp((const unsigned char*)&searcher->chip8 + MACHINE_STATE_OFFSET, snapshot->state, MACHINE_STATE_SIZE) != 0)
+        return 0;
+    for (int i = 0; i < NUM_PAGES; i++)
+        if (memcmp(searcher->chip8.memory + i * PAGE_SIZE, snapshot->pages[i]->data, PAGE_SIZE) != 0)
+            return 0;
+    return 1;
+}
@@ -0,0 +1,167 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/recording.h"
+#include "headers/snapshot.h"
+
+#include <string.h>
+
+static Page* allocatePage(PagePool* pool) {
+    // returns a page with one reference, or NULL if out of memory (or over maxPages)
+    if (pool->maxPages > 0 && pool->pagesInUse >= pool->maxPages)
+        return NULL;
+    if (pool->free == NULL) {
+        Page** blocks = realloc(pool->blocks, (pool->numBlocks + 1) * sizeof(Page*));
+        if (blocks == NULL)
+            return NULL;
+        pool->blocks = blocks;
+        Page* block = malloc(PAGES_PER_BLOCK * sizeof(Page));
+        if (block == NULL)
+            return NULL;
+        pool->blocks[pool->numBlocks++] = block;
+        for (int i = PAGES_PER_BLOCK - 1; i >= 0; i--) {
+            block[i].next = pool->free;
+            pool->free = &block[i];
+        }
+    }
+
+    Page* page = pool->free;
+    pool->free = page->next;
+    page->references = 1;
+    pool->pagesInUse++;
+    return page;
+}
+
+static void releasePage(PagePool* pool, Page* page) {
+    if (--page->references > 0)
+        return;
+    page->next = pool->free;
+    pool->free = page;
+    pool->pagesInUse--;
+}
+
+int createSearcher(Searcher* searcher, const CHIP8* root, EngineType type, unsigned int instructionsPerFrame) {
+    // the working machine starts as root. Take the root snapshot with captureSnapshot
+    searcher->chip8 = *root;
+    searcher->instructionsPerFrame = instructionsPerFrame;
+    searcher->pool.free = NULL;
+    searcher->pool.blocks = NULL;
+    searcher->pool.numBlocks = 0;
+    searcher->pool.pagesInUse = 0;
+    searcher->pool.maxPages = 0;
+    if (createEngine(&searcher->engine, type))
+        return 1;
+
+    for (int i = 0; i < NUM_PAGES; i++) {
+        searcher->loaded[i] = allocatePage(&searcher->pool);
+        if (searcher->loaded[i] == NULL) {
+            fprintf(stderr, "Error allocating snapshot pages\n");
+            return 1;
+        }
+        memcpy(searcher->loaded[i]->data, root->memory + i * PAGE_SIZE, PAGE_SIZE);
+    }
+    return 0;
+}
+
+void destroySearcher(Searcher* searcher) {
+    // every snapshot taken from this searcher goes with it
+    for (int i = 0; i < searcher->pool.numBlocks; i++)
+        free(searcher->pool.blocks[i]);
+    free(searcher->pool.blocks);
+    searcher->pool.blocks = NULL;
+    searcher->pool.numBlocks = 0;
+    destroyEngine(&searcher->engine);
+}
+
+static void forgetWrittenPages(Searcher* searcher, int first) {
+    // from page first on, the working memory no longer holds what loaded says wherever it was written to: hold
+    // nothing there, so the next restore copies those pages back in whatever snapshot it is
+    for (int i = first; i < NUM_PAGES; i++) {
+        Page* page = searcher->loaded[i];
+        if (page != NULL && memcmp(page->data, searcher->chip8.memory + i * PAGE_SIZE, PAGE_SIZE) != 0) {
+            releasePage(&searcher->pool, page);
+            searcher->loaded[i] = NULL;
+        }
+    }
+}
+
+int captureSnapshot(Searcher* searcher, Snapshot* snapshot) {
+    // snapshot = the working machine. Pages it has not written since the last restore or capture are shared with
+    // whatever snapshot they came from. Returns 1 if out of memory
+    memcpy(snapshot->state, (const unsigned char*)&searcher->chip8 + MACHINE_STATE_OFFSET, MACHINE_STATE_SIZE);
+
+    for (int i = 0; i < NUM_PAGES; i++) {
+        const unsigned char* memory = searcher->chip8.memory + i * PAGE_SIZE;
+        Page* page = searcher->loaded[i];
+        if (page == NULL || memcmp(page->data, memory, PAGE_SIZE) != 0) {
+            // written to: the new contents get a page of their own, which is now what the working memory holds
+            page = allocatePage(&searcher->pool);
+            if (page == NULL) {
+                fprintf(stderr, "Error allocating snapshot pages\n");
+                for (int j = 0; j < i; j++)
+                    releasePage(&searcher->pool, snapshot->pages[j]);
+                forgetWrittenPages(searcher, i);
+                return 1;
+            }
+            memcpy(page->data, memory, PAGE_SIZE);
+            if (searcher->loaded[i] != NULL)
+                releasePage(&searcher->pool, searcher->loaded[i]);
+            searcher->loaded[i] = page;
+        }
+        page->references++;
+        snapshot->pages[i] = page;
+    }
+    return 0;
+}
+
+void restoreSnapshot(Searcher* searcher, const Snapshot* snapshot) {
+    // working machine = snapshot, copying only the pages it does not hold already
+    memcpy((unsigned char*)&searcher->chip8 + MACHINE_STATE_OFFSET, snapshot->state, MACHINE_STATE_SIZE);
+
+    for (int i = 0; i < NUM_PAGES; i++) {
+        Page* page = snapshot->pages[i];
+        if (page == searcher->loaded[i])
+            continue;
+        memcpy(searcher->chip8.memory + i * PAGE_SIZE, page->data, PAGE_SIZE);
+        invalidateEngine(&searcher->engine, i * PAGE_SIZE, PAGE_SIZE);
+        page->references++;
+        if (searcher->loaded[i] != NULL)
+            releasePage(&searcher->pool, searcher->loaded[i]);
+        searcher->loaded[i] = page;
+    }
+
+    // what the idle detector learnt was about the machine it was watching, not this one
+    resetIdleDetector(&searcher->engine.idle);
+}
+
+void cloneSnapshot(Snapshot* clone, const Snapshot* snapshot) {
+    // clone shares every page with snapshot, release both when done
+    memcpy(clone->state, snapshot->state, MACHINE_STATE_SIZE);
+    for (int i = 0; i < NUM_PAGES; i++) {
+        clone->pages[i] = snapshot->pages[i];
+        clone->pages[i]->references++;
+    }
+}
+
+int stepSnapshot(Searcher* searcher, Snapshot* snapshot, unsigned short keys, unsigned int frames) {
+    // advances snapshot by frames frames with keys held (clone it first to keep where it was). Returns 1 if out
+    // of memory, in which case snapshot is left as it was
+    restoreSnapshot(searcher, snapshot);
+    applyKeyboardMask(searcher->chip8.keyboard, keys);
+    for (unsigned int frame = 0; frame < frames; frame++)
+        runFrame(&searcher->engine, &searcher->chip8, searcher->instructionsPerFrame);
+
+    Snapshot next;
+    if (captureSnapshot(searcher, &next))
+        return 1;
+    releaseSnapshot(searcher, snapshot);
+    *snapshot = next;
+    return 0;
+}
+
+void releaseSnapshot(Searcher* searcher, Snapshot* snapshot) {
+    for (int i = 0; i < NUM_PAGES; i++) {
+        releasePage(&searcher->pool, snapshot->pages[i]);
+        snapshot->pages[i] = NULL;
+    }
+}
@@ -0,0 +1,90 @@
+#include "headers/chip8.h"
+#include "headers/stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+void packHeader(unsigned char* out, unsigned char type, unsigned char instance, int length) {
+    out[0] = type;
+    out[1] = instance;
+    put16(out + 2, length);
+}
+
+void put16(unsigned char* out, unsigned int value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+}
+
+void put32(unsigned char* out, unsigned int value) {
+    put16(out, value & 0xFFFF);
+    put16(out + 2, value >> 16);
+}
+
+unsigned int get16(const unsigned char* in) {
+    return in[0] | (in[1] << 8);
+}
+
+unsigned int get32(const unsigned char* in) {
+    return get16(in) | (get16(in + 2) << 16);
+}
+
+int sendMessage(int fd, unsigned char type, unsigned char instance, const unsigned char* payload, int length) {
+    // for blocking sockets: returns 0 once the whole message is written, 1 if the connection is gone
+    unsigned char message[MAX_MESSAGE_SIZE];
+    packHeader(message, type, instance, length);
+    memcpy(message + MESSAGE_HEADER_SIZE, payload, length);
+
+    int written = 0;
+    while (written < MESSAGE_HEADER_SIZE + length) {
+        ssize_t result = write(fd, message + written, MESSAGE_HEADER_SIZE + length - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return 1;
+        written += result;
+    }
+    return 0;
+}
+
+void initializeReader(MessageReader* reader) {
+    reader->start = 0;
+    reader->length = 0;
+}
+
+int receiveMessages(MessageReader* reader, int fd) {
+    // reads whatever is there (without blocking on a non-blocking socket). Returns 0 once the other end has closed
+    // the connection or sent something that is not a message, 1 otherwise
+    memmove(reader->buffer, reader->buffer + reader->start, reader->length - reader->start);
+    reader->length -= reader->start;
+    reader->start = 0;
+
+    ssize_t result = read(fd, reader->buffer + reader->length, sizeof(reader->buffer) - reader->length);
+    if (result < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (result == 0)
+        return 0;
+    reader->length += result;
+
+    if (reader->length >= MESSAGE_HEADER_SIZE && get16(reader->buffer + 2) > MAX_PAYLOAD_SIZE)
+        return 0;
+    return 1;
+}
+
+int nextMessage(MessageReader* reader, Message* message) {
+    // returns 1 and fills message if a whole one has arrived
+    int available = reader->length - reader->start;
+    if (available < MESSAGE_HEADER_SIZE)
+        return 0;
+    const unsigned char* header = reader->buffer + reader->start;
+    int length = get16(header + 2);
+    if (length > MAX_PAYLOAD_SIZE || available < MESSAGE_HEADER_SIZE + length)
+        return 0;
+
+    message->type = header[0];
+    message->instance = header[1];
+    message->length = length;
+    message->payload = header + MESSAGE_HEADER_SIZE;
+    reader->start += MESSAGE_HEADER_SIZE + length;
+    return 1;
+}
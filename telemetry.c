@@ -0,0 +1,127 @@
+#include "headers/chip8.h"
+#include "headers/telemetry.h"
+
+static const char* names[NUM_METRICS] = { "emulation", "instructions", "sleep overshoot", "upload", "present" };
+static const char* units[NUM_METRICS] = { "ns", "instructions", "ns", "ns", "ns" };
+
+static int binOf(unsigned long long value) {
+    // values below HISTOGRAM_SUB_BINS get a bin each, above that each power of two is split into HISTOGRAM_SUB_BINS
+    if (value < HISTOGRAM_SUB_BINS)
+        return value;
+    int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BINS + ((value >> shift) & (HISTOGRAM_SUB_BINS - 1));
+}
+
+static unsigned long long binTop(int bin) {
+    // the largest value that lands in bin
+    if (bin < HISTOGRAM_SUB_BINS)
+        return bin;
+    int shift = bin / HISTOGRAM_SUB_BINS - 1;
+    unsigned long long sub = HISTOGRAM_SUB_BINS + bin % HISTOGRAM_SUB_BINS;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void increase(atomic_ullong* value, unsigned long long amount) {
+    // only ever called by the histogram's one writer, so no read-modify-write is needed
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+void initializeTelemetry(Telemetry* telemetry) {
+    for (int metric = 0; metric < NUM_METRICS; metric++) {
+        Histogram* histogram = &telemetry->histograms[metric];
+        for (int bin = 0; bin < HISTOGRAM_BINS; bin++)
+            atomic_init(&histogram->bins[bin], 0);
+        atomic_init(&histogram->count, 0);
+        atomic_init(&histogram->total, 0);
+        atomic_init(&histogram->max, 0);
+    }
+}
+
+void recordMetric(Telemetry* telemetry, int metric, unsigned long long value) {
+    Histogram* histogram = &telemetry->histograms[metric];
+    increase(&histogram->bins[binOf(value)], 1);
+    increase(&histogram->total, value);
+    if (value > atomic_load_explicit(&histogram->max, memory_order_relaxed))
+        atomic_store_explicit(&histogram->max, value, memory_order_relaxed);
+    increase(&histogram->count, 1); // last, so a reader never sees more in count than in the bins
+}
+
+unsigned long long metricPercentile(const Telemetry* telemetry, int metric, double fraction) {
+    // the top of the bin the value at fraction (0.5 for p50) falls in, but never more than the largest value seen
+    const Histogram* histogram = &telemetry->histograms[metric];
+    unsigned long long count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0)
+        return 0;
+
+    unsigned long long rank = (unsigned long long)(fraction * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    unsigned long long seen = 0;
+    unsigned long long max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    for (int bin = 0; bin < HISTOGRAM_BINS; bin++) {
+        seen += atomic_load_explicit(&histogram->bins[bin], memory_order_relaxed);
+        if (seen >= rank)
+            return binTop(bin) < max ? binTop(bin) : max;
+    }
+    return max;
+}
+
+unsigned long long metricCount(const Telemetry* telemetry, int metric) {
+    return atomic_load_explicit(&telemetry->histograms[metric].count, memory_order_relaxed);
+}
+
+unsigned long long metricMax(const Telemetry* telemetry, int metric) {
+    return atomic_load_explicit(&telemetry->histograms[metric].max, memory_order_relaxed);
+}
+
+const char* metricName(int metric) {
+    return names[metric];
+}
+
+const char* metricUnit(int metric) {
+    return units[metric];
+}
+
+void formatMetric(char* out, int size, int metric, unsigned long long value) {
+    // times in whatever unit keeps them short, counts as they are
+    if (units[metric][0] != 'n')
+        snprintf(out, size, "%llu", value);
+    else if (value < 1000)
+        snprintf(out, size, "%lluns", value);
+    else if (value < 1000000)
+        snprintf(out, size, "%.1fus", value / 1e3);
+    else
+        snprintf(out, size, "%.1fms", value / 1e6);
+}
+
+int writeTelemetry(const Telemetry* telemetry, const char* filename) {
+    FILE* file = fopen(filename, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", filename);
+        return 1;
+    }
+
+    fprintf(file, "metric,unit,count,mean,p50,p90,p99,max\n");
+    for (int metric = 0; metric < NUM_METRICS; metric++) {
+        unsigned long long count = metricCount(telemetry, metric);
+        unsigned long long total = atomic_load_explicit(&telemetry->histograms[metric].total, memory_order_relaxed);
+        fprintf(file, "%s,%s,%llu,%.1f,%llu,%llu,%llu,%llu\n", names[metric], units[metric], count,
+            count ? (double)total / count : 0.0, metricPercentile(telemetry, metric, 0.5),
+            metricPercentile(telemetry, metric, 0.9), metricPercentile(telemetry, metric, 0.99), metricMax(telemetry, metric));
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void printTelemetry(const Telemetry* telemetry) {
+    for (int metric = 0; metric < NUM_METRICS; metric++) {
+        if (metricCount(telemetry, metric) == 0)
+            continue;
+        char p50[32], p99[32], max[32];
+        formatMetric(p50, sizeof(p50), metric, metricPercentile(telemetry, metric, 0.5));
+        formatMetric(p99, sizeof(p99), metric, metricPercentile(telemetry, metric, 0.99));
+        formatMetric(max, sizeof(max), metric, metricMax(telemetry, metric));
+        printf("%s: p50 %s, p99 %s, max %s (%llu samples)\n", names[metric], p50, p99, max, metricCount(telemetry, metric));
+    }
+}
@@ -0,0 +1,179 @@
+#include "headers/chip8.h"
+#include "headers/trace.h"
+
+#include <string.h>
+#include <unistd.h>
+
+static void writeValue(FILE* file, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+static unsigned long long readValue(const unsigned char* in, int bytes) {
+    unsigned long long value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (unsigned long long)in[i] << (8 * i);
+    return value;
+}
+
+unsigned long reserveTrace(TraceRing* ring, unsigned long records) {
+    // how many of the next records fit in the ring (the rest are counted as dropped). Only looks at how far the
+    // flush thread has got when the room it knew about is not enough
+    if (ring->head - ring->tailSeen + records > TRACE_RING_RECORDS)
+        ring->tailSeen = atomic_load_explicit(&ring->read, memory_order_acquire);
+    unsigned long room = TRACE_RING_RECORDS - (ring->head - ring->tailSeen);
+    if (records <= room)
+        return records;
+    ring->droppedCount += records - room;
+    atomic_store_explicit(&ring->dropped, ring->droppedCount, memory_order_relaxed);
+    return room;
+}
+
+void publishTrace(TraceRing* ring, unsigned long records) {
+    // hand the records just written to the flush thread
+    ring->head += records;
+    atomic_store_explicit(&ring->written, ring->head, memory_order_release);
+}
+
+void setTraceInstance(TraceRing* ring, unsigned int instance) {
+    // label the records that follow. Waits for the flush thread to empty the ring first, so no record is ever
+    // put down to the wrong instance (called between instances, never while one runs)
+    while (atomic_load_explicit(&ring->read, memory_order_acquire) != ring->head)
+        usleep(TRACE_FLUSH_US);
+    atomic_store_explicit(&ring->instance, instance, memory_order_release);
+}
+
+int openTracer(Tracer* tracer, const char* filename, int numRings) {
+    if (numRings > MAX_TRACE_RINGS) {
+        fprintf(stderr, "At most %d instances can be traced at once\n", MAX_TRACE_RINGS);
+        return 1;
+    }
+    tracer->file = fopen(filename, "wb");
+    if (tracer->file == NULL) {
+        fprintf(stderr, "Error opening %s for writing\n", filename);
+        return 1;
+    }
+    setvbuf(tracer->file, NULL, _IOFBF, TRACE_FILE_BUFFER);
+    fwrite(TRACE_MAGIC, 1, 4, tracer->file);
+    writeValue(tracer->file, TRACE_VERSION, 2);
+    writeValue(tracer->file, sizeof(TraceRecord), 2);
+
+    tracer->numRings = numRings;
+    for (int i = 0; i < numRings; i++) {
+        TraceRing* ring = aligned_alloc(64, sizeof(TraceRing));
+        if (ring == NULL) {
+            fprintf(stderr, "Error allocating the trace rings\n");
+            return 1;
+        }
+        atomic_init(&ring->instance, i);
+        ring->head = 0;
+        ring->tailSeen = 0;
+        ring->droppedCount = 0;
+        atomic_init(&ring->written, 0);
+        atomic_init(&ring->dropped, 0);
+        atomic_init(&ring->read, 0);
+        tracer->rings[i] = ring;
+        tracer->droppedWritten[i] = 0;
+    }
+
+    atomic_init(&tracer->quit, 0);
+    if (pthread_create(&tracer->thread, NULL, runTraceFlush, tracer) != 0) {
+        fprintf(stderr, "Error creating the trace flush thread\n");
+        return 1;
+    }
+    return 0;
+}
+
+int closeTracer(Tracer* tracer) {
+    // stops the flush thread, writes out what is left in the rings and closes the file. Nothing may still be
+    // tracing into the rings. Returns 1 if any of the trace could not be written
+    atomic_store(&tracer->quit, 1);
+    pthread_join(tracer->thread, NULL);
+    unsigned long long dropped = 0;
+    for (int i = 0; i < tracer->numRings; i++) {
+        flushTraceRing(tracer, i);
+        dropped += tracer->droppedWritten[i];
+        free(tracer->rings[i]);
+    }
+    if (dropped > 0)
+        printf("%llu trace records were dropped while the file fell behind\n", dropped);
+
+    int error = ferror(tracer->file);
+    if (fclose(tracer->file) != 0 || error) {
+        fprintf(stderr, "Error writing the trace\n");
+        return 1;
+    }
+    return 0;
+}
+
+void* runTraceFlush(void* arg) {
+    // empties the rings into the file in large chunks: a pass that took out less than half a ring's worth from
+    // every ring is followed by a sleep, so the flush thread is not forever reading the lines the core writes
+    Tracer* tracer = arg;
+    while (!atomic_load(&tracer->quit)) {
+        int busiest = 0;
+        for (int i = 0; i < tracer->numRings; i++) {
+            int flushed = flushTraceRing(tracer, i);
+            if (flushed > busiest)
+                busiest = flushed;
+        }
+        if (busiest < TRACE_RING_RECORDS / 2)
+            usleep(TRACE_FLUSH_US);
+    }
+    return NULL;
+}
+
+int flushTraceRing(Tracer* tracer, int index) {
+    // writes everything in one ring as one chunk, returns how many records that was
+    TraceRing* ring = tracer->rings[index];
+    // dropped before written: records are only dropped while the ring is full, so every drop counted here comes
+    // after the records this chunk takes out
+    unsigned long long dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+    unsigned long long written = atomic_load_explicit(&ring->written, memory_order_acquire);
+    unsigned long long read = atomic_load_explicit(&ring->read, memory_order_relaxed);
+    unsigned int count = written - read;
+    if (count == 0 && dropped == tracer->droppedWritten[index])
+        return 0;
+
+    // after written: the label set before these records were published, never an older one
+    writeValue(tracer->file, atomic_load_explicit(&ring->instance, memory_order_acquire), 4);
+    writeValue(tracer->file, count, 4);
+    writeValue(tracer->file, dropped - tracer->droppedWritten[index], 8);
+    unsigned int start = read & (TRACE_RING_RECORDS - 1);
+    unsigned int first = count < TRACE_RING_RECORDS - start ? count : TRACE_RING_RECORDS - start; // up to the end of the ring
+    fwrite(&ring->records[start], sizeof(TraceRecord), first, tracer->file);
+    fwrite(ring->records, sizeof(TraceRecord), count - first, tracer->file);
+
+    tracer->droppedWritten[index] = dropped;
+    atomic_store_explicit(&ring->read, written, memory_order_release);
+    return count;
+}
+
+int readTraceHeader(FILE* file) {
+    // returns 0 if file starts with a trace this version can read
+    unsigned char header[TRACE_HEADER_SIZE];
+    if (fread(header, 1, TRACE_HEADER_SIZE, file) != TRACE_HEADER_SIZE || memcmp(header, TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "Not a trace\n");
+        return 1;
+    }
+    if (readValue(header + 4, 2) != TRACE_VERSION || readValue(header + 6, 2) != sizeof(TraceRecord)) {
+        fprintf(stderr, "Unsupported trace version %llu\n", readValue(header + 4, 2));
+        return 1;
+    }
+    return 0;
+}
+
+int readTraceChunk(FILE* file, TraceChunk* chunk, TraceRecord* records) {
+    // reads the next chunk into records (room for TRACE_RING_RECORDS), returns 1 if there was one
+    unsigned char header[TRACE_CHUNK_HEADER_SIZE];
+    if (fread(header, 1, TRACE_CHUNK_HEADER_SIZE, file) != TRACE_CHUNK_HEADER_SIZE)
+        return 0;
+    chunk->instance = readValue(header, 4);
+    chunk->count = readValue(header + 4, 4);
+    chunk->dropped = readValue(header + 8, 8);
+    if (chunk->count > TRACE_RING_RECORDS || fread(records, sizeof(TraceRecord), chunk->count, file) != chunk->count) {
+        fprintf(stderr, "Trace is cut off\n");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,122 @@
+#include "headers/chip8.h"
+#include "headers/trace.h"
+#include "headers/disasm.h"
+#include "headers/tracedump.h"
+
+/*
+    - prints a trace written by ./main --trace or ./headless -T, one disassembled instruction per line:
+      instance, pc, opcode, mnemonic, then I and whichever of Vx and VF the instruction wrote, as they were after it ran
+    - -i keeps one instance, -p a range of addresses (hex, FIRST-LAST or just one), -o an opcode pattern
+      (hex, OPCODE/MASK, e.g. D000/F000 for every draw). Records lost to a full ring are reported where they went missing
+*/
+
+int main(int argc, char *argv[]) {
+    TraceFilter filter = { ALL_INSTANCES, 0, MEMORY_SIZE - 1, 0, 0 };
+
+    // parse the options, the last argument is the trace
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (!parseFilter(&filter, argv[arg], argv[arg+1])) {
+            fprintf(stderr, "Invalid option %s %s\n", argv[arg], argv[arg+1]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    if (arg != argc - 1) {
+        fprintf(stderr, "Usage: ./tracedump [-i INSTANCE] [-p FIRST-LAST] [-o OPCODE[/MASK]] [TRACE PATH]\n");
+        exit(1);
+    }
+
+    FILE* file = fopen(argv[arg], "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error opening %s\n", argv[arg]);
+        exit(1);
+    }
+    if (readTraceHeader(file))
+        exit(1);
+
+    TraceRecord* records = malloc(TRACE_RING_RECORDS * sizeof(TraceRecord));
+    if (records == NULL) {
+        fprintf(stderr, "Error allocating the trace buffer\n");
+        exit(1);
+    }
+
+    TraceChunk chunk;
+    unsigned long long total = 0, shown = 0, dropped = 0;
+    while (readTraceChunk(file, &chunk, records)) {
+        if (filter.instance != ALL_INSTANCES && chunk.instance != filter.instance)
+            continue;
+        for (unsigned int i = 0; i < chunk.count; i++) {
+            if (!matchesFilter(&filter, chunk.instance, &records[i]))
+                continue;
+            printRecord(chunk.instance, &records[i]);
+            shown++;
+        }
+        if (chunk.dropped > 0)
+            printf("-- instance %u: %llu records dropped --\n", chunk.instance, chunk.dropped);
+        total += chunk.count;
+        dropped += chunk.dropped;
+    }
+
+    fprintf(stderr, "%llu of %llu records shown, %llu dropped\n", shown, total, dropped);
+    free(records);
+    fclose(file);
+    return 0;
+}
+
+int parseFilter(TraceFilter* filter, const char* option, const char* value) {
+    // returns 0 if the option is unknown or its value does not parse
+    char* end;
+    if (strcmp(option, "-i") == 0) {
+        filter->instance = strtol(value, &end, 10);
+        return *value != '\0' && *end == '\0' && filter->instance >= 0;
+    }
+    if (strcmp(option, "-p") == 0) {
+        filter->firstPC = strtoul(value, &end, 16);
+        filter->lastPC = *end == '-' ? strtoul(end + 1, &end, 16) : filter->firstPC;
+        return *value != '\0' && *end == '\0';
+    }
+    if (strcmp(option, "-o") == 0) {
+        filter->opcode = strtoul(value, &end, 16);
+        filter->opcodeMask = *end == '/' ? strtoul(end + 1, &end, 16) : 0xFFFF;
+        filter->opcode &= filter->opcodeMask;
+        return *value != '\0' && *end == '\0';
+    }
+    return 0;
+}
+
+int matchesFilter(const TraceFilter* filter, unsigned int instance, const TraceRecord* record) {
+    return (filter->instance == ALL_INSTANCES || instance == filter->instance)
+        && record->pc >= filter->firstPC && record->pc <= filter->lastPC
+        && (record->opcode & filter->opcodeMask) == filter->opcode;
+}
+
+int writesVx(unsigned short opcode) {
+    // the record always holds Vx, this says whether the instruction stored anything there
+    switch(opcode & 0xF000) {
+        case 0x6000: case 0x7000: case 0x8000: case 0xC000:
+            return 1;
+        case 0xF000:
+            return (opcode & 0x00FF) == 0x07 || (opcode & 0x00FF) == 0x0A || (opcode & 0x00FF) == 0x65; // Fx65 writes V0 to Vx
+        default:
+            return 0;
+    }
+}
+
+int writesVF(unsigned short opcode) {
+    // 8xy4 to 8xyE and Dxyn set the flag
+    return ((opcode & 0xF000) == 0x8000 && (opcode & 0x000F) >= 0x4) || (opcode & 0xF000) == 0xD000;
+}
+
+void printRecord(unsigned int instance, const TraceRecord* record) {
+    // e.g. "   0  0x22A  7E01  ADD VE, 0x01          I=0x2EA  VE=0x05"
+    char mnemonic[32];
+    disassemble(record->opcode, mnemonic, sizeof(mnemonic));
+    printf("%4u  0x%03X  %04X  %-20s  I=0x%03X", instance, record->pc, record->opcode, mnemonic, record->I);
+    if (writesVx(record->opcode))
+        printf("  V%X=0x%02X", (record->opcode & 0x0F00) >> 8, record->Vx);
+    if (writesVF(record->opcode))
+        printf("  VF=0x%02X", record->VF);
+    printf("\n");
+}
@@ -0,0 +1,294 @@
+#include "headers/chip8.h"
+#include "headers/engine.h"
+#include "headers/scheduler.h"
+#include "headers/frames.h"
+#include "headers/telemetry.h"
+#include "headers/screen.h"
+#include "headers/present.h"
+#include "headers/wall.h"
+
+/*
+    - a monitoring wall: many instances in one window, each ROM dealt out round-robin like ./headless does
+    - one thread emulates every instance and hands each screen that changed to the UI thread through that
+      instance's triple buffer. The UI thread keeps all the screens in a single streaming texture (an atlas laid
+      out as the grid itself), uploads only the rows of the tiles that changed, and presents the whole grid with
+      one SDL_RenderCopy at most once per display refresh
+*/
+
+int main(int argc, char *argv[]) {
+    EngineType engineType = ENGINE_PREDECODE;
+    unsigned int instructionsPerFrame = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    unsigned int seed = DEFAULT_SEED;
+    int numInstances = 0;
+    int columns = 0;
+
+    // parse the options, everything after them is a ROM path
+    int arg = 1;
+    while (arg + 1 < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-e") == 0) {
+            if (!parseEngineType(argv[arg+1], &engineType)) {
+                fprintf(stderr, "Unknown engine %s\n", argv[arg+1]);
+                exit(1);
+            }
+        } else if (strcmp(argv[arg], "-r") == 0 && atoi(argv[arg+1]) > 0) {
+            instructionsPerFrame = atoi(argv[arg+1]);
+        } else if (strcmp(argv[arg], "-n") == 0 && atoi(argv[arg+1]) > 0) {
+            numInstances = atoi(argv[arg+1]);
+        } else if (strcmp(argv[arg], "-c") == 0 && atoi(argv[arg+1]) > 0) {
+            columns = atoi(argv[arg+1]);
+        } else if (strcmp(argv[arg], "-s") == 0) {
+            seed = strtoul(argv[arg+1], NULL, 10);
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[arg]);
+            exit(1);
+        }
+        arg += 2;
+    }
+
+    int numROMs = argc - arg;
+    if (numInstances == 0)
+        numInstances = numROMs;
+    if (numROMs < 1 || numInstances > MAX_WALL_INSTANCES) {
+        fprintf(stderr, "Usage: ./wall [-n INSTANCES] [-c COLUMNS] [-r INSTRUCTIONS PER FRAME] [-e ENGINE] [-s SEED] [ROM PATH]... (up to %d instances)\n", MAX_WALL_INSTANCES);
+        exit(1);
+    }
+
+    // the instances are aligned for their triple buffers
+    size_t size = (numInstances * sizeof(WallInstance) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    WallInstance* instances = aligned_alloc(CACHE_LINE, size);
+    if (instances == NULL) {
+        fprintf(stderr, "Error allocating %d instances\n", numInstances);
+        exit(1);
+    }
+    for (int i = 0; i < numInstances; i++) {
+        const char* romPath = argv[arg + i % numROMs];
+        initializeEmulator(&instances[i].chip8);
+        if (loadROM(&instances[i].chip8, romPath))
+            exit(1);
+        seedRandom(&instances[i].chip8, seed + i);
+        if (createEngine(&instances[i].engine, engineType))
+            exit(1);
+        if (engineType == ENGINE_AOT && loadAotModule(instances[i].engine.aot, romPath))
+            exit(1);
+        instances[i].engine.idle.enabled = 1;
+        initializeFrameBuffer(&instances[i].frames);
+    }
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        fprintf(stderr, "SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    // as square a grid as fits the instances, scaled up as far as the window allows
+    if (columns == 0)
+        while (columns * columns < numInstances)
+            columns++;
+    if (columns > numInstances)
+        columns = numInstances;
+    int rows = (numInstances + columns - 1) / columns;
+    int scaleX = MAX_WINDOW_WIDTH / (columns * TILE_WIDTH);
+    int scaleY = MAX_WINDOW_HEIGHT / (rows * TILE_HEIGHT);
+    int scale = scaleX < scaleY ? scaleX : scaleY;
+    if (scale < 1)
+        scale = 1;
+
+    SDL_Window* window = SDL_CreateWindow("CHIP-8 Wall", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        columns * TILE_WIDTH * scale, rows * TILE_HEIGHT * scale, SDL_WINDOW_SHOWN);
+    SDL_Renderer* renderer = window != NULL ? SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC) : NULL;
+    if (renderer == NULL) {
+        fprintf(stderr, "Window could not be created! SDL_Error: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    static Telemetry telemetry;
+    initializeTelemetry(&telemetry);
+    Wall wall;
+    if (createWall(&wall, window, renderer, numInstances, columns, &telemetry))
+        exit(1);
+
+    Scheduler scheduler;
+    initializeScheduler(&scheduler, instructionsPerFrame, 0);
+
+    WallCore core;
+    core.instances = instances;
+    core.numInstances = numInstances;
+    core.scheduler = &scheduler;
+    core.telemetry = &telemetry;
+    atomic_init(&core.framePending, 0);
+    atomic_init(&core.quit, 0);
+
+    SDL_Thread* coreThread = SDL_CreateThread(runWall, "emulation", &core);
+    if (coreThread == NULL) {
+        fprintf(stderr, "Error creating the emulation thread: %s\n", SDL_GetError());
+        exit(1);
+    }
+
+    int quit = 0;
+    while (!quit) {
+        SDL_Event e;
+        while (SDL_PollEvent(&e)) {
+            if (e.type == SDL_QUIT || (e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_ESCAPE))
+                quit = 1;
+            else if (e.type == SDL_WINDOWEVENT)
+                wall.forceRedraw = 1;
+        }
+
+        // collect the newest frame of every instance, then present them all together once a refresh is due
+        atomic_store(&core.framePending, 0);
+        int pending = 0;
+        for (int i = 0; i < numInstances; i++) {
+            unsigned long long tag;
+            const unsigned long long* latest = takeFrame(&instances[i].frames, &tag);
+            if (latest != NULL)
+                wall.latest[i] = latest;
+            pending |= wall.latest[i] != NULL;
+        }
+        pending |= wall.forceRedraw;
+        if (pending && presentWall(&wall, numInstances))
+            pending = 0;
+
+        SDL_WaitEventTimeout(NULL, pending ? millisecondsUntilWallRefresh(&wall) : IDLE_WAIT_MS);
+    }
+
+    atomic_store(&core.quit, 1);
+    SDL_WaitThread(coreThread, NULL);
+    printTelemetry(&telemetry);
+
+    destroyWall(&wall);
+    for (int i = 0; i < numInstances; i++)
+        destroyEngine(&instances[i].engine);
+    free(instances);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
+
+int runWall(void* data) {
+    WallCore* core = data;
+
+    // the first frame of every tile, before anything is drawn
+    for (int i = 0; i < core->numInstances; i++)
+        publishFrame(&core->instances[i].frames, core->instances[i].chip8.screen, 0);
+
+    while (!atomic_load(&core->quit)) {
+        int frames = framesDue(core->scheduler);
+        int published = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            unsigned long long start = monotonicNanoseconds();
+            unsigned long long executed = 0;
+            for (int i = 0; i < core->numInstances; i++) {
+                WallInstance* instance = &core->instances[i];
+                unsigned long long skipped = instance->engine.idle.skipped;
+                runFrame(&instance->engine, &instance->chip8, core->scheduler->instructionsPerFrame);
+                executed += core->scheduler->instructionsPerFrame - (instance->engine.idle.skipped - skipped);
+                if (instance->chip8.drawFlag) {
+                    publishFrame(&instance->frames, instance->chip8.screen, 0);
+                    instance->chip8.drawFlag = 0;
+                    published = 1;
+                }
+            }
+            recordMetric(core->telemetry, METRIC_EMULATION, monotonicNanoseconds() - start);
+            recordMetric(core->telemetry, METRIC_INSTRUCTIONS, executed);
+        }
+
+        // one event for however many tiles changed, and none while the last one is still waiting
+        if (published && !atomic_exchange(&core->framePending, 1)) {
+            SDL_Event event;
+            memset(&event, 0, sizeof(event));
+            event.type = SDL_USEREVENT;
+            SDL_PushEvent(&event);
+        }
+
+        unsigned int timeout = millisecondsUntilNextFrame(core->scheduler);
+        if (timeout > 0)
+            SDL_Delay(timeout);
+    }
+    return 0;
+}
+
+int createWall(Wall* wall, SDL_Window* window, SDL_Renderer* renderer, int numInstances, int columns, Telemetry* telemetry) {
+    wall->renderer = renderer;
+    wall->columns = columns;
+    wall->rows = (numInstances + columns - 1) / columns;
+    wall->refreshNanoseconds = refreshNanoseconds(window);
+    wall->lastPresent = 0;
+    wall->forceRedraw = 1;
+    wall->telemetry = telemetry;
+    wall->shown = calloc(numInstances, sizeof(*wall->shown));
+    wall->latest = calloc(numInstances, sizeof(*wall->latest));
+    if (wall->shown == NULL || wall->latest == NULL) {
+        fprintf(stderr, "Error allocating the wall\n");
+        return 1;
+    }
+
+    int width = wall->columns * TILE_WIDTH;
+    int height = wall->rows * TILE_HEIGHT;
+    wall->atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (wall->atlas == NULL) {
+        fprintf(stderr, "Texture could not be created! SDL_Error: %s\n", SDL_GetError());
+        return 1;
+    }
+
+    // the gaps (and cells past the last instance) are drawn once, tiles start blank like shown
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(wall->atlas, NULL, &pixels, &pitch) != 0) {
+        fprintf(stderr, "Texture could not be locked! SDL_Error: %s\n", SDL_GetError());
+        return 1;
+    }
+    for (int y = 0; y < height; y++) {
+        unsigned int* row = (unsigned int*)((unsigned char*)pixels + y * pitch);
+        for (int x = 0; x < width; x++) {
+            int tile = (y / TILE_HEIGHT) * wall->columns + x / TILE_WIDTH;
+            int gap = x % TILE_WIDTH >= SCREEN_WIDTH || y % TILE_HEIGHT >= SCREEN_HEIGHT || tile >= numInstances;
+            row[x] = gap ? GAP_COLOR : PIXEL_OFF;
+        }
+    }
+    SDL_UnlockTexture(wall->atlas);
+    return 0;
+}
+
+void destroyWall(Wall* wall) {
+    SDL_DestroyTexture(wall->atlas);
+    free(wall->shown);
+    free(wall->latest);
+}
+
+int presentWall(Wall* wall, int numInstances) {
+    // returns 1 if the new frames were dealt with, 0 if they have to wait for the next refresh
+    unsigned long long now = monotonicNanoseconds();
+    if (now - wall->lastPresent < wall->refreshNanoseconds)
+        return 0;
+
+    int uploaded = 0;
+    for (int i = 0; i < numInstances; i++) {
+        if (wall->latest[i] == NULL)
+            continue;
+        int x = (i % wall->columns) * TILE_WIDTH;
+        int y = (i / wall->columns) * TILE_HEIGHT;
+        uploaded |= uploadChangedRows(wall->atlas, x, y, wall->latest[i], wall->shown[i]);
+        wall->latest[i] = NULL;
+    }
+    if (!uploaded && !wall->forceRedraw)
+        return 1;
+
+    unsigned long long presentStart = monotonicNanoseconds();
+    recordMetric(wall->telemetry, METRIC_UPLOAD, presentStart - now);
+    SDL_RenderClear(wall->renderer);
+    SDL_RenderCopy(wall->renderer, wall->atlas, NULL, NULL);
+    SDL_RenderPresent(wall->renderer);
+    recordMetric(wall->telemetry, METRIC_PRESENT, monotonicNanoseconds() - presentStart);
+
+    wall->lastPresent = now;
+    wall->forceRedraw = 0;
+    return 1;
+}
+
+unsigned int millisecondsUntilWallRefresh(const Wall* wall) {
+    // how long frames presentWall turned down have to wait, rounded up
+    unsigned long long elapsed = monotonicNanoseconds() - wall->lastPresent;
+    if (elapsed >= wall->refreshNanoseconds)
+        return 0;
+    return (wall->refreshNanoseconds - elapsed + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND;
+}